@@ -0,0 +1,19 @@
+#ifndef _ALLOC_COUNTER_
+#define _ALLOC_COUNTER_
+
+#include <cstddef>
+
+// Heap allocations made through operator new by every thread while
+// counting is on, for --stats. Replacing operator new is the
+// executable's business, only the command line front end links it in.
+struct AllocCount
+{
+    size_t allocs = 0;
+    size_t bytes = 0;
+};
+
+void startCountingAllocs();
+void stopCountingAllocs();
+AllocCount getAllocCount();
+
+#endif
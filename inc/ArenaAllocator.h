@@ -1,50 +1,109 @@
 #pragma once
 
+#include <cassert>
+#include <memory>
+#include <vector>
 
+
+// Objects allocated in blocks of blockElems (or what's reserved),
+// a new block is added whenever the last one is full, so the objects
+// never move and there is no upper bound but the one the user
+// checks size() against
 template <typename T>
 class ArenaAllocator
 {
 public:
-    ArenaAllocator(size_t elems) : m_size(elems * sizeof(T)), m_occupied(0)
-    {
-        m_buffer = new char[m_size];
-        m_offset = m_buffer;
-    }
+    ArenaAllocator(size_t blockElems) : m_blockElems(blockElems > 0 ? blockElems : 1), m_occupied(0)
+    {}
 
     ArenaAllocator(const ArenaAllocator &other) = delete;
     ArenaAllocator operator=(const ArenaAllocator &other) = delete;
 
     ~ArenaAllocator()
     {
-        size_t i = 0;
-        while (i < m_occupied)
-        {        
-            T *objPtr = reinterpret_cast<T*>(m_buffer + i);
-            if (objPtr == NULL)
-            {
-                break;
-            }
+        for (size_t i = 0; i < m_occupied; ++i)
+        {
 #ifdef MISC_DEBUG
-            std::cout << (void*)(m_buffer + i) << '\n';
+            std::cout << (void*)slotAt(i) << '\n';
 #endif
-
-            objPtr->~T();
-            i += sizeof(T);
+            reinterpret_cast<T*>(slotAt(i))->~T();
         }
-        delete[] m_buffer;
     }
 
     char *allocate()
     {
-        char *offset = m_offset;
-        m_offset += sizeof(T);
-        m_occupied += sizeof(T);
-        return offset;
+        if (m_occupied == m_blocks.size() * m_blockElems)
+            addBlock();
+        return slotAt(m_occupied++);
+    }
+
+    // blocks of elems from then on, the first one allocated
+    // right away, only before anything else is
+    void reserve(size_t elems)
+    {
+        if (!m_blocks.empty() || elems == 0)
+            return;
+        m_blockElems = elems;
+        addBlock();
+    }
+
+    // destroys obj and everything allocated after it,
+    // the space is reused by the next allocations
+    void releaseFrom(T *obj)
+    {
+        const size_t from = indexOf(obj);
+        assert(from < m_occupied);
+        releaseFrom(from);
+    }
+
+    // same, from the object at idx in allocation order
+    void releaseFrom(size_t idx)
+    {
+        for (size_t i = idx; i < m_occupied; ++i)
+        {
+            reinterpret_cast<T*>(slotAt(i))->~T();
+        }
+        if (idx < m_occupied)
+            m_occupied = idx;
+    }
+
+    // in allocation order, size() if it isn't from here
+    size_t indexOf(const T *obj) const
+    {
+        return indexOf(reinterpret_cast<const char*>(obj));
+    }
+
+    // the objects alive
+    size_t size() const
+    {
+        return m_occupied;
     }
 
 private:
-    size_t m_size;
+    size_t m_blockElems;
     size_t m_occupied;
-    char *m_buffer;
-    char *m_offset;
-};
\ No newline at end of file
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+
+    void addBlock()
+    {
+        // uninitialized, the objects are constructed in it
+        m_blocks.emplace_back(new char[m_blockElems * sizeof(T)]);
+    }
+
+    char *slotAt(size_t idx) const
+    {
+        return m_blocks[idx / m_blockElems].get() + (idx % m_blockElems) * sizeof(T);
+    }
+
+    // releases are of the recent objects, so from the last block down
+    size_t indexOf(const char *slot) const
+    {
+        for (size_t blockIdx = m_blocks.size(); blockIdx-- > 0; )
+        {
+            const char *block = m_blocks[blockIdx].get();
+            if (slot >= block && slot < block + m_blockElems * sizeof(T))
+                return blockIdx * m_blockElems + (slot - block) / sizeof(T);
+        }
+        return m_occupied;
+    }
+};
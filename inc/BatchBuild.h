@@ -0,0 +1,74 @@
+#ifndef _BATCH_BUILD_
+#define _BATCH_BUILD_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "JackCompilerTypes.h"
+#include "CompileDriver.h"
+#include "ThreadPool.h"
+#include "DEBUG_CONTROL.h"
+
+// One line of the manifest and how it went
+struct BatchProject
+{
+    std::string srcPath;
+    std::string outDir;
+
+    bool success = false;
+    size_t numFiles = 0;
+    std::vector<std::string> diagnostics;
+};
+
+// Manifest lines: <source path> <output directory>, relative paths
+// are the manifest's directory's, empty lines and '#' comments skipped
+bool loadManifest(const std::string &filePath, std::vector<BatchProject> &projects,
+    std::ostream &err);
+
+// Compiles many programs against the same libraries (--batch). The
+// libraries are lexed, go through phase 1 and are generated once,
+// every project then gets its own context layered on theirs, so the
+// projects are compiled in parallel without seeing each other.
+// Library code doesn't depend on the programs using it,
+// the same outputs are written to every project's directory.
+class BatchBuild
+{
+private:
+    CompilerOptions options;
+    DiscoveryOptions discovery;
+    ThreadPool &pool;
+
+    std::unique_ptr<CompilerContext> libsContext;
+    std::vector<SourceUnit> libUnits;
+
+    void buildProject(BatchProject &project);
+
+public:
+    BatchBuild(const CompilerOptions &options, const DiscoveryOptions &discovery, ThreadPool &pool);
+
+    // false if the libraries couldn't be compiled, nothing to build on then
+    bool loadLibs(const std::vector<std::string> &libsPaths, std::ostream &err);
+
+    // the files discovery finds in libsPaths are still
+    // the ones loadLibs compiled, none of them changed
+    bool libsUnchanged(const std::vector<std::string> &libsPaths) const;
+
+    // what a context compiling against the libraries is layered on
+    const CompilerContext &getLibsContext() const
+    {
+        return *libsContext;
+    }
+
+    // the libraries' code into outDir, what can't be written is reported to err
+    bool writeLibs(const std::string &outDir, BatchIO &io, std::ostream &err) const;
+
+    // true if all the projects were compiled
+    bool build(std::vector<BatchProject> &projects);
+
+    // a JSON document, for the scripts running the batches
+    static void writeSummary(const std::vector<BatchProject> &projects, std::ostream &strm);
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _BATCH_IO_
+#define _BATCH_IO_
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "ThreadPool.h"
+#include "StageTimes.h"
+#include "DEBUG_CONTROL.h"
+
+// a whole file read into data
+struct FileRead
+{
+    const std::string *path;
+    std::string *data;
+    bool done = false;
+};
+
+// data written as the whole file
+struct FileWrite
+{
+    std::string path;
+    const std::string *data;
+    bool done = false;
+};
+
+class IoUring;
+
+// Reads and writes the files of a compilation in batches. With io_uring
+// the opens, sizes, reads/writes and closes of all files are each one
+// batch of requests, a few syscalls for any number of files. Without it
+// (older kernels, or turned off) the files are read and written with
+// pread/pwrite on the pool.
+class BatchIO
+{
+private:
+    ThreadPool &pool;
+    std::unique_ptr<IoUring> ring;
+    // all batches so far, for --time-report
+    StageTime readTime;
+    StageTime writeTime;
+
+    bool readFilesRing(std::vector<FileRead> &reads);
+    bool writeFilesRing(std::vector<FileWrite> &writes);
+
+public:
+    BatchIO(ThreadPool &pool, bool useIoUring);
+    ~BatchIO();
+
+    bool getUsesIoUring() const
+    {
+        return ring != nullptr;
+    }
+
+    // done tells for each file whether it was read/written completely
+    void readFiles(std::vector<FileRead> &reads);
+    void writeFiles(std::vector<FileWrite> &writes);
+
+    // the CPU time of the whole process while the batches ran
+    const StageTime &getReadTime() const
+    {
+        return readTime;
+    }
+    const StageTime &getWriteTime() const
+    {
+        return writeTime;
+    }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef _BUILD_RECORDS_
+#define _BUILD_RECORDS_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include "CompileDriver.h"
+#include "CompilerContext.h"
+#include "SourceCache.h"
+#include "DEBUG_CONTROL.h"
+
+// What every file was last built from: its stamp and the signatures
+// of the other classes' subroutines its code called. Kept in a file
+// next to the outputs, so that a build generates only what is out of
+// date. A change to a class's function bodies leaves the files calling
+// it alone, only a change to a signature they used invalidates them.
+class BuildRecords
+{
+private:
+    struct UnitRecord
+    {
+        FileStamp stamp;
+        std::map<std::string, std::string> funcDeps;
+    };
+
+    // by source path
+    std::unordered_map<std::string, UnitRecord> records;
+    // the compiler and the options the records were made with,
+    // the records of another build of it are dropped
+    std::string header;
+
+public:
+    static constexpr const char *fileName = ".jackdeps";
+
+    explicit BuildRecords(const CompilerOptions &options);
+
+    // path of the records kept with the outputs in outDir
+    static std::string recordsPath(const std::string &outDir);
+
+    // no records (everything is out of date) if the file
+    // is missing or not readable
+    bool load(const std::string &filePath);
+    bool save(const std::string &filePath) const;
+
+    // After phase 1: sets generate for the units that changed, have no
+    // output in outDir or used a signature that isn't the same anymore.
+    // Returns how many are to be generated.
+    size_t markOutOfDate(CompilerContext &context, std::vector<SourceUnit> &units,
+        const std::string &outDir) const;
+
+    // After phase 2: records the units built and forgets the ones that
+    // failed (built again next time) or aren't part of the build anymore
+    void update(const std::vector<SourceUnit> &units);
+};
+
+#endif
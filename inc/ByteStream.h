@@ -0,0 +1,70 @@
+#ifndef _BYTE_STREAM_
+#define _BYTE_STREAM_
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+// Fixed-size integers and length-prefixed strings in native byte
+// order, for data passed between processes of the same build
+struct ByteWriter
+{
+    std::string bytes;
+
+    void putU32(uint32_t value)
+    {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    void putString(const std::string &str)
+    {
+        putU32(str.size());
+        bytes += str;
+    }
+};
+
+// Reading past the end fails the reader, every later read too
+class ByteReader
+{
+private:
+    const char *data;
+    size_t size;
+    size_t pos = 0;
+    bool failed = false;
+
+public:
+    ByteReader(const char *data, size_t size) : data(data), size(size)
+    {}
+
+    bool getU32(uint32_t &value)
+    {
+        if (failed || size - pos < sizeof(value))
+            return failed = true, false;
+        memcpy(&value, data + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+    bool getString(std::string &str)
+    {
+        uint32_t len = 0;
+        if (!getU32(len) || size - pos < len)
+            return failed = true, false;
+        str.assign(data + pos, len);
+        pos += len;
+        return true;
+    }
+
+    bool getFailed() const
+    {
+        return failed;
+    }
+    size_t getPos() const
+    {
+        return pos;
+    }
+    bool atEnd() const
+    {
+        return pos == size;
+    }
+};
+
+#endif
@@ -27,7 +27,7 @@ inline unsigned int ldType_to_classID(LangDataTypes ldType)
     return (unsigned int)(ldType) - (unsigned int)(LangDataTypes::ldCLASS);
 }
 
-inline std::map<TokenTypes, LangDataTypes> tTypes_to_ldTypes
+inline const std::map<TokenTypes, LangDataTypes> tTypes_to_ldTypes
 {
     {TokenTypes::tINT, LangDataTypes::ldINT},
     {TokenTypes::tBOOLEAN, LangDataTypes::ldBOOLEAN},
@@ -41,7 +41,7 @@ inline std::map<TokenTypes, LangDataTypes> tTypes_to_ldTypes
 
 inline LangDataTypes tType_to_ldType(TokenTypes tType)
 {
-    std::map<TokenTypes, LangDataTypes>::iterator iter;
+    std::map<TokenTypes, LangDataTypes>::const_iterator iter;
     iter = tTypes_to_ldTypes.find(tType);
 
     if (iter != tTypes_to_ldTypes.end())
@@ -50,7 +50,7 @@ inline LangDataTypes tType_to_ldType(TokenTypes tType)
     return LangDataTypes::ldUNKNOWN;
 }
 
-inline std::map<LangDataTypes, TokenTypes> ldTypes_to_tTypes
+inline const std::map<LangDataTypes, TokenTypes> ldTypes_to_tTypes
 {
     {LangDataTypes::ldINT, TokenTypes::tINT},
     {LangDataTypes::ldBOOLEAN, TokenTypes::tBOOLEAN},
@@ -64,7 +64,7 @@ inline std::map<LangDataTypes, TokenTypes> ldTypes_to_tTypes
 
 inline TokenTypes ldType_to_tType(LangDataTypes ldType)
 {
-    std::map<LangDataTypes, TokenTypes>::iterator iter;
+    std::map<LangDataTypes, TokenTypes>::const_iterator iter;
     iter = ldTypes_to_tTypes.find(ldType);
 
     if (iter != ldTypes_to_tTypes.end())
@@ -0,0 +1,57 @@
+#ifndef _CLASS_GRAPH_
+#define _CLASS_GRAPH_
+
+#include <iostream>
+#include <vector>
+
+#include "CompileDriver.h"
+#include "DEBUG_CONTROL.h"
+
+// Which units refer to the classes of which others, from a scan of the
+// tokens for the names of the classes the units define. Units referring
+// to each other in a cycle are one component, the components are in
+// waves: a component's wave comes after the ones of everything it
+// refers to. The cost of a unit is its number of tokens.
+class ClassGraph
+{
+private:
+    // by unit, the units it refers to
+    std::vector<std::vector<size_t>> unitDeps;
+    std::vector<size_t> unitCosts;
+
+    // in topological order, what a component refers to comes before it
+    std::vector<std::vector<size_t>> components;
+    std::vector<size_t> componentByUnit;
+    std::vector<unsigned int> componentWaves;
+    unsigned int numWaves = 0;
+
+    // the components on the most expensive chain
+    // of references, the referred to first
+    std::vector<size_t> criticalPath;
+    size_t criticalPathCost = 0;
+
+    void findComponents();
+    void findWaves();
+
+public:
+    // after the classes are declared
+    explicit ClassGraph(const std::vector<SourceUnit> &units);
+
+    unsigned int getUnitWave(size_t unitIdx) const
+    {
+        return componentWaves[componentByUnit[unitIdx]];
+    }
+    unsigned int getNumWaves() const
+    {
+        return numWaves;
+    }
+
+    // the order to start the units in: wave by wave,
+    // in a wave the most expensive first
+    std::vector<size_t> scheduleOrder() const;
+
+    // the waves, the cycles and the critical path
+    void report(const std::vector<SourceUnit> &units, std::ostream &strm) const;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef _COMPILE_DRIVER_
+#define _COMPILE_DRIVER_
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <chrono>
+
+#include "LexerTypes.h"
+#include "ParserTypes.h"
+#include "StageTimes.h"
+#include "CompilerContext.h"
+#include "ThreadPool.h"
+#include "SourceCache.h"
+#include "FuncCodeCache.h"
+#include "BatchIO.h"
+#include "DEBUG_CONTROL.h"
+
+// What went through a unit's stages, for --stats
+struct UnitStats
+{
+    size_t sourceBytes = 0;
+    size_t tokens = 0;
+    // the unit's own, before they're merged into the context's
+    size_t identifiers = 0;
+    size_t astNodes = 0;
+    size_t vmBytes = 0;
+    // VM commands, counted for --time-report only
+    size_t vmInstructions = 0;
+    // buffers reserved from the size estimates that still had to grow
+    size_t estimatesExceeded = 0;
+};
+
+// One input file on its way through the phases
+struct SourceUnit
+{
+    // output name, the class name for one class per file
+    std::string name;
+    // read from here unless the source is in memory
+    std::string filePath;
+    // the source, for files only until it's lexed
+    std::string text;
+
+    // the unit's own tokens, released as soon as the
+    // unit is parsed, the identifiers are the context's
+    LexerState lexState;
+    bool lexed = false;
+    // what it was lexed into, for after its tokens are released
+    size_t numTokens = 0;
+    // the file as it was lexed
+    FileStamp stamp;
+    // the classes the unit defines, their name ids
+    std::vector<unsigned int> classNameIDs;
+    // when the parallel stages start the unit, see ClassGraph
+    size_t schedulePos = 0;
+    // phase 2 is skipped for units whose output is up to date
+    bool generate = true;
+    // "Class.function" of other classes -> the signature the
+    // code was generated against (empty if it was missing)
+    std::map<std::string, std::string> funcDeps;
+    // the parser got through all the tokens
+    bool parsed = false;
+    // phase 1 stopped at a limit (reported), phase 2 is skipped
+    bool overLimit = false;
+    // lexing, parsing and generating it so far, the
+    // stages share the unit's --max-file-ms
+    std::chrono::steady_clock::duration busyTime{0};
+    UnitStats stats;
+    // the stages the unit goes through on its own, for --time-report
+    StageTimes times;
+    StateVisits stateVisits{};
+
+    // lexer echo and AST dump, not kept for in-memory units
+    std::ostringstream lexLog;
+    std::ostringstream log;
+    std::ostringstream diagnostics;
+    // the generated code, for files only until it's written
+    std::string vmCode;
+    // empty for in-memory units
+    std::string outFilePath;
+};
+
+// What a long running process (the server, --watch) keeps
+// between its compilations, shared by them
+struct CompileCaches
+{
+    SourceCache sources;
+    FuncCodeCache funcs;
+};
+
+// Compiles the units as one program, everything shared between them
+// lives in context. inMemory: sources are taken from the units' text
+// and the code is left in vmCode, nothing is read, written or logged.
+// Otherwise the files are read (unchanged ones from the cache,
+// if any) and the .vm files written.
+// Returns false if a unit couldn't be read or parsed, the
+// diagnostics can also report problems code was generated around.
+bool compileUnits(CompilerContext &context, ThreadPool &pool,
+    std::vector<SourceUnit> &units, bool inMemory, SourceCache *cache = NULL);
+
+// The steps of compileUnits, for the callers that decide
+// in between which units to generate.
+// The files are read and written through io (only in-memory units
+// don't need one), the ones not in the cache in one batch.
+// Lexing, the identifiers stay local to the units. A unit over one
+// of the limits isn't lexed, its diagnostics tell which and why.
+void lexUnits(ThreadPool &pool, std::vector<SourceUnit> &units, const ResourceLimits &limits,
+    bool inMemory, SourceCache *cache, BatchIO *io);
+// Merging the identifiers, declaring the classes, scheduling the units
+// by their class graph (reported to scheduleLog if not NULL) and phase 1.
+void parseSignatures(CompilerContext &context, ThreadPool &pool, std::vector<SourceUnit> &units,
+    std::ostream *scheduleLog = NULL);
+// Phase 2 and the output of the units to generate,
+// unchanged functions' code from funcCache if there is one.
+void generateUnits(CompilerContext &context, ThreadPool &pool,
+    std::vector<SourceUnit> &units, bool inMemory, BatchIO *io, FuncCodeCache *funcCache = NULL);
+bool unitsSucceeded(const std::vector<SourceUnit> &units);
+
+// For the pipelines that run the stages their own way.
+// When the unit, started (again) at start, runs out of --max-file-ms.
+std::chrono::steady_clock::time_point unitDeadline(const SourceUnit &unit, const ResourceLimits &limits,
+    std::chrono::steady_clock::time_point start);
+// a unit over --max-file-size is reported and not read or lexed
+bool overFileSize(SourceUnit &unit, uintmax_t size, const ResourceLimits &limits);
+
+// the units' stats added up, one line each
+void printStats(const std::vector<SourceUnit> &units, std::ostream &out);
+
+// --time-report: the units' stages one line each, then the stages of
+// the build, lex, parse and codegen being the units' added up and the
+// rest (run as batches) the ones in buildTimes. total is the whole build.
+// Then the throughput and how often the parsers went through each state.
+void printTimeReport(const std::vector<SourceUnit> &units, const StageTimes &buildTimes,
+    const StageTime &total, std::ostream &out);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef _COMPILE_SERVER_
+#define _COMPILE_SERVER_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "DEBUG_CONTROL.h"
+
+// Serves one request: the client's arguments (without the program
+// name) and its working directory. What the compilation prints goes
+// to out and err, the result is the exit code the client returns.
+typedef std::function<int(const std::vector<std::string> &args, const std::string &workDir,
+    std::ostream &out, std::ostream &err)> serveRequestFunc;
+
+// Compile server listening on a Unix domain socket, every connection
+// is one request and is served on its own thread, at most
+// maxConnections at a time. Whatever is to be kept warm between
+// the requests is kept by the handler. The socket is the server's
+// user's only (0600), and a request is only served for that user
+// (SO_PEERCRED) in a working directory the user owns.
+//
+// Protocol, all integers 32 bit in host order, strings length-prefixed:
+//   request:  count, working directory, arguments... (strings of up
+//             to 64 KiB, up to 4096 of them, bigger requests are dropped)
+//   response: frames of (channel byte, string), 'o' for stdout, 'e' for
+//             stderr, ended by 'x' and the exit code
+class CompileServer
+{
+private:
+    std::string socketPath;
+    int listenFd = -1;
+    serveRequestFunc handleRequest;
+
+    unsigned int maxConnections;
+    unsigned int numConnections = 0;
+    std::mutex connectionsMutex;
+    std::condition_variable connectionDone;
+
+    void serveConnection(int connFd);
+
+public:
+    CompileServer(const std::string &socketPath, serveRequestFunc handleRequest,
+        unsigned int maxConnections = 32);
+    ~CompileServer();
+
+    CompileServer(const CompileServer &other) = delete;
+    CompileServer &operator=(const CompileServer &other) = delete;
+
+    // false if the socket can't be set up,
+    // otherwise serves until the process is stopped
+    bool run();
+};
+
+// The client side of --connect: sends the arguments to the server,
+// prints what comes back and returns the server's exit code.
+int runCompileClient(const std::string &socketPath, int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _COMPILER_CONTEXT_
+#define _COMPILER_CONTEXT_
+
+#include <string>
+#include <unordered_map>
+
+#include "JackCompilerTypes.h"
+#include "LexerTypes.h"
+#include "CheckerTypes.h"
+#include "Hierarchy.h"
+#include "DEBUG_CONTROL.h"
+
+// Everything one compilation shares between its files: the identifier
+// table, the classes and the options. Nothing of it is process-global,
+// so independent compilations can run in one process concurrently,
+// each with its own context.
+class CompilerContext
+{
+private:
+    CompilerOptions options;
+    identifierVect identifiers;
+    std::unordered_map<std::string, unsigned int> identIdxByName;
+    ClassTable classTable;
+
+    void appendFuncSignature(std::string &sig, const FunctionData &func);
+
+    unsigned int arrayLib_className_id = 0;
+    // for implicit argument to all class methods, is in a way a "variable name"
+    unsigned int thisNameID = 0;
+
+public:
+    explicit CompilerContext(const CompilerOptions &options);
+    // Layered on base: starts out with its identifiers and classes,
+    // anything added or filled in later is this context's own.
+    // Nothing may change base while it's copied.
+    CompilerContext(const CompilerContext &base, const CompilerOptions &options);
+
+    CompilerContext(const CompilerContext &other) = delete;
+    CompilerContext &operator=(const CompilerContext &other) = delete;
+
+    // id of ident in the identifier table, added if new
+    unsigned int addIdentifier(const std::string &ident);
+
+    // room for numMore identifiers to be added without rehashing
+    void reserveIdentifiers(size_t numMore);
+
+    // Files are lexed with their own identifier tables, the ids in their
+    // tokens are remapped to the context's table here. Merging in file
+    // order hands out the same ids as lexing all files into one table.
+    void mergeIdentifiers(LexerState &lexState);
+
+    // classes defined in the tokens get their ids now (in the order
+    // of the calls), before files are parsed concurrently,
+    // returns the name ids of the classes
+    std::vector<unsigned int> declareClasses(const tokensVect &tokens);
+
+    // false if nothing in the compilation has the name
+    bool findIdentifier(const std::string &ident, unsigned int &identID) const;
+
+    // what callers in other classes depend on: the subroutine's kind
+    // and types, by name, so it compares across compilations,
+    // empty if there's no such subroutine
+    std::string getFuncSignature(unsigned int classNameID, unsigned int funcNameID);
+
+    inline const CompilerOptions &getOptions() const
+    {
+        return options;
+    }
+    inline const identifierVect &getIdentifiers() const
+    {
+        return identifiers;
+    }
+    inline ClassTable &getClassTable()
+    {
+        return classTable;
+    }
+    inline unsigned int getArrayLibClassNameID() const
+    {
+        return arrayLib_className_id;
+    }
+    inline unsigned int getThisNameID() const
+    {
+        return thisNameID;
+    }
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _DIR_WATCHER_
+#define _DIR_WATCHER_
+
+#include <string>
+
+#include "DEBUG_CONTROL.h"
+
+// Waits for the files with one extension in a few
+// directories to change, using inotify
+class DirWatcher
+{
+private:
+    int inotifyFd = -1;
+    std::string fileExt;
+    // once a change is seen, more events coming within
+    // this time are taken as part of the same change
+    static constexpr int settleMs = 50;
+
+    // true if a file of interest changed, false on
+    // failure or if a watched directory is gone
+    bool readEvents(bool &changed);
+
+public:
+    explicit DirWatcher(const std::string &fileExt);
+    ~DirWatcher();
+
+    DirWatcher(const DirWatcher &other) = delete;
+    DirWatcher &operator=(const DirWatcher &other) = delete;
+
+    bool addDir(const std::string &dirPath);
+
+    // blocks until a file changes (is written, created,
+    // moved or deleted), false if watching failed
+    bool waitForChanges();
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _FILE_DISCOVERY_
+#define _FILE_DISCOVERY_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "JackCompilerTypes.h"
+#include "ThreadPool.h"
+#include "DEBUG_CONTROL.h"
+
+bool isJackFile(const std::string &path);
+
+bool matchGlob(const std::string &glob, const std::string &path);
+
+// The .jack files of the roots in root order, each directory root's sorted
+// by path, a file found through several roots only the first time. A root
+// that is a file is taken as it is. The directories are listed in parallel,
+// dirPaths (if not NULL) gets the ones walked.
+// False if a directory couldn't be listed.
+bool discoverFiles(const std::vector<std::string> &roots, const DiscoveryOptions &options,
+    ThreadPool &pool, std::vector<std::string> &filePaths,
+    std::vector<std::string> *dirPaths = NULL, std::ostream &err = std::cerr);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _FUNC_CODE_CACHE_
+#define _FUNC_CODE_CACHE_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+
+#include "ParserTypes.h"
+#include "VmWriter.h"
+#include "DEBUG_CONTROL.h"
+
+// The code generated for functions, by a hash of what it's generated
+// from: the function's tokens, the declarations of its class and the
+// signatures of the subroutines it calls (see Parser::addFuncKey).
+// Labels are numbered per function, so nothing else goes into it and
+// an unchanged function of an edited file is not generated again.
+// Shared by the compilations of a server or a --watch session, the
+// hashes only have to be the same within the process.
+class FuncCodeCache
+{
+public:
+    struct Key
+    {
+        uint64_t hash = 0;
+        // the function's, compared as well, a
+        // cheap guard against collisions
+        uint32_t numTokens = 0;
+
+        void add(uint64_t value)
+        {
+            hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        }
+
+        bool operator==(const Key &other) const
+        {
+            return hash == other.hash && numTokens == other.numTokens;
+        }
+    };
+
+    // the keys of a unit's functions by their subtrees' roots
+    typedef std::unordered_map<const AstNode*, Key> FuncKeys;
+
+private:
+    struct KeyHasher
+    {
+        size_t operator()(const Key &key) const
+        {
+            return key.hash;
+        }
+    };
+
+    // dropped all at once when full, the functions of
+    // the next build get generated and cached again
+    static constexpr size_t maxEntries = 1 << 16;
+
+    std::unordered_map<Key, std::string, KeyHasher> codeByKey;
+    mutable std::shared_mutex mutex;
+
+public:
+    // appends the cached code to output, false if there's none
+    bool fetch(const Key &key, VmWriter &output) const;
+
+    void store(const Key &key, const VmWriter &output);
+};
+
+#endif
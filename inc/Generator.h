@@ -1,37 +1,128 @@
 #ifndef _GENERATOR_
-#define _GENERATOR
+#define _GENERATOR_
 
 #include <iostream>
 #include <string>
 #include <cstring>
 #include <vector>
 #include <fstream>
+#include <filesystem>
+#include <cassert>
+#include <chrono>
 
 #include "LexerTypes.h"
 #include "CheckerTypes.h"
 #include "ParserTypes.h"
 #include "GeneratorTypes.h"
+#include "VmWriter.h"
+#include "ThreadPool.h"
+#include "FuncCodeCache.h"
+#include "StageTimes.h"
 #include "DEBUG_CONTROL.h"
 
+// What generating a subtree writes to. Function subtrees
+// don't share anything else, so each can get its own
+// and be generated independently of the others.
+struct GenState
+{
+    VmWriter output;
+    // full name of the function being generated,
+    // labels are scoped by it
+    std::string curFuncName;
+};
+
 class Generator
 {
 private:
-    std::vector<std::string> outputLines;
+    GenState mainState;
     std::string outFilePath;
 
     const identifierVect &identifiers;
+
+    // checked before every function, see setDeadline
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    bool outOfTime = false;
+    // see getCpuTime
+    std::chrono::nanoseconds cpuTime{0};
+
+    static void collectFuncNodes(AstNode *curRoot, std::vector<AstNode*> &funcNodes);
 public:
     bool init(const sourceFileNameType &srcFileName);
 
     Generator(const sourceFileNameType &srcFileName, const identifierVect &identifiers);
 
+    // the functions not started by then aren't generated,
+    // the output is incomplete and getOutOfTime() true
+    void setDeadline(std::chrono::steady_clock::time_point deadlinePar)
+    {
+        deadline = deadlinePar;
+    }
+
+    bool getOutOfTime() const
+    {
+        return outOfTime;
+    }
+
+    // the CPU time generate took, summed over
+    // the threads the functions were generated on
+    std::chrono::nanoseconds getCpuTime() const
+    {
+        return cpuTime;
+    }
+
+    void reserveOutput(size_t numBytes)
+    {
+        mainState.output.reserve(numBytes);
+    }
+
+    // ends the output the way the .vm files end
+    void finishOutput();
+
+    // writes the code generated so far to fd and drops it,
+    // for outputs written while they're generated
+    bool flushOutput(int fd);
+
+    // relative to the working directory by default
+    void setOutDir(const std::string &outDir);
+
     void writeFile();
+
+    const std::string &getOutFilePath() const
+    {
+        return outFilePath;
+    }
+
+    const VmWriter &getOutput() const
+    {
+        return mainState.output;
+    }
+
+    static void appendNodeValue(const AstNode *astNode, VmWriter &output);
     
-    void genForNode(AstNode *astNode);
+    static void genForNode(AstNode *astNode, GenState &state);
+
+    static void generateCode(AstNode *curRoot, GenState &state);
 
     void generateCode(AstNode *curRoot);
 
-    void generateAndWrite(AstNode *curRoot);
+    // every function subtree is generated into its own buffer (on
+    // the pool if any) or taken from the cache, the buffers are then
+    // joined in source order
+    void generateFuncs(AstNode *curRoot, ThreadPool *pool, FuncCodeCache *funcCache,
+        const FuncCodeCache::FuncKeys *funcKeys);
+
+    // same as generateCode, but skips the children
+    // that direct emission has generated already
+    void generatePending(AstNode *curRoot);
+
+    // in parallel if the pool has more than one thread,
+    // reusing the code of the functions in the cache (the
+    // ones with a key, see Parser::keepFuncKeys), function
+    // by function if there's a deadline
+    void generate(AstNode *curRoot, ThreadPool *pool = NULL, FuncCodeCache *funcCache = NULL,
+        const FuncCodeCache::FuncKeys *funcKeys = NULL);
+
+    void generateAndWrite(AstNode *curRoot, ThreadPool *pool = NULL);
 };
 
 #endif
\ No newline at end of file
@@ -1,28 +1,32 @@
 #ifndef _GENERATOR_TYPES_
 #define _GENERATOR_TYPES_
 
+#include <array>
+
 #include "DEBUG_CONTROL.h"
 
 typedef std::string sourceFileNameType;
-typedef std::map<AstNodeTypes, std::string>::iterator genMapIter;
+typedef std::map<AstNodeTypes, std::string>::const_iterator genMapIter;
 
 // TODO: validation: if node generates code but its type not found in
 // generationLookup, then we made a mistake somewhere
-inline std::map<AstNodeTypes, std::string> generationLookup
+inline const std::map<AstNodeTypes, std::string> generationLookup
 {
-    {AstNodeTypes::aWHILE_START,    "label while_start_lbl_$\r\n"},
-    {AstNodeTypes::aWHILE_JUMP,     "if-goto while_end_lbl_$\r\n"},
-    {AstNodeTypes::aWHILE_END,      "goto while_start_lbl_$\r\n"},
-    {AstNodeTypes::aWHILE,          "label while_end_lbl_$\r\n"},
+    // @ is the label namespace of the enclosing function ("Class.func$"),
+    // label ids are numbered per function
+    {AstNodeTypes::aWHILE_START,    "label @while_start_$\r\n"},
+    {AstNodeTypes::aWHILE_JUMP,     "if-goto @while_end_$\r\n"},
+    {AstNodeTypes::aWHILE_END,      "goto @while_start_$\r\n"},
+    {AstNodeTypes::aWHILE,          "label @while_end_$\r\n"},
 
     // INVERSION FOR IF
-    {AstNodeTypes::aIF_JUMP,        "if-goto if_end_lbl_$\r\n"},
-    {AstNodeTypes::aIF,             "label if_end_lbl_$\r\n"},
+    {AstNodeTypes::aIF_JUMP,        "if-goto @if_end_$\r\n"},
+    {AstNodeTypes::aIF,             "label @if_end_$\r\n"},
 
     // work because ifNode doesn't generate code upon else block discovery
-    {AstNodeTypes::aELSE_START,     "label if_end_lbl_$\r\n"},
-    {AstNodeTypes::aELSE_JUMP,      "goto else_end_lbl_$\r\n"},
-    {AstNodeTypes::aELSE,           "label else_end_lbl_$\r\n"},
+    {AstNodeTypes::aELSE_START,     "label @if_end_$\r\n"},
+    {AstNodeTypes::aELSE_JUMP,      "goto @else_end_$\r\n"},
+    {AstNodeTypes::aELSE,           "label @else_end_$\r\n"},
 
     {AstNodeTypes::aNUMBER,          "push constant $\r\n"},
     {AstNodeTypes::aLOCAL_VAR_READ,  "push local $\r\n"},
@@ -75,6 +79,52 @@ inline std::map<AstNodeTypes, std::string> generationLookup
     {AstNodeTypes::aTEMP_VAR_READ,    "push temp $\r\n"}
 };
 
-inline std::string outFileExt = "vm";
+// generationLookup split around the @ and $ wildcards once at startup,
+// indexed by AstNodeTypes, so that emitting an instruction
+// is an array access and a few appends
+struct EmitTemplate
+{
+    bool present = false;
+    bool hasFuncScope = false;
+    bool hasValue = false;
+    std::string prefix;
+    // between @ and $
+    std::string infix;
+    std::string suffix;
+};
+
+typedef std::array<EmitTemplate, (size_t)AstNodeTypes::aUNKNOWN + 1> emitTemplatesArr;
+
+inline emitTemplatesArr buildEmitTemplates()
+{
+    emitTemplatesArr templates;
+    for (const auto &[aType, codeLine] : generationLookup)
+    {
+        auto &tmpl = templates[(size_t)aType];
+        tmpl.present = true;
+
+        size_t scopePos = codeLine.find('@');
+        size_t wcardPos = codeLine.find('$');
+        tmpl.prefix = codeLine.substr(0, std::min(scopePos, wcardPos));
+
+        if (scopePos != std::string::npos)
+        {
+            tmpl.hasFuncScope = true;
+            size_t infixEnd = wcardPos == std::string::npos ? codeLine.size() : wcardPos;
+            tmpl.infix = codeLine.substr(scopePos + 1, infixEnd - scopePos - 1);
+        }
+        if (wcardPos != std::string::npos)
+        {
+            tmpl.hasValue = true;
+            tmpl.suffix = codeLine.substr(wcardPos + 1);
+        }
+    }
+    return templates;
+}
+
+// NOTE: defined after generationLookup, which it's built from
+inline const emitTemplatesArr emitTemplates = buildEmitTemplates();
+
+inline const std::string outFileExt = "vm";
 
 #endif
\ No newline at end of file
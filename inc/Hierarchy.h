@@ -1,8 +1,11 @@
 #ifndef _HIERARCHY_
 #define _HIERARCHY_
-#include <stack>
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <algorithm>
+#include <mutex>
+#include <shared_mutex>
 #include <cassert>
 
 enum class ScopeTypes : unsigned int
@@ -22,79 +25,47 @@ struct VariableData
     {}
 };
 
-struct LocalScopeFrame
+// The locals of the function being parsed, in one vector that is
+// truncated when the function ends, so the next one reuses its capacity
+// and a function without locals doesn't allocate anything.
+// Jack has no nested local scopes.
+struct FuncLocals
 {
 private:
     std::vector<VariableData> localVars;
 public:
-    std::tuple<bool, unsigned int> containsVar(unsigned int nameID)
+    void begin()
     {
-        auto iter = std::find_if(localVars.begin(), localVars.end(), 
-            [&nameID](const VariableData  &arg){ return arg.nameID == nameID; });
-
-        return {iter != localVars.end(), 
-                std::distance(localVars.begin(), iter)};
+        // a function the parser stopped in never got to its end
+        localVars.clear();
+    }
+    void end()
+    {
+        localVars.clear();
     }
     void addVar(unsigned int nameID, LangDataTypes valueType)
     {
         assert(isvartype(ldType_to_tType(valueType)));
         localVars.emplace_back(nameID, valueType);
     }
-    unsigned int getNumOfLocals() const
+
+    std::tuple<bool, unsigned int> containsVar(unsigned int nameID) const
     {
-        return localVars.size();
+        auto iter = std::find_if(localVars.begin(), localVars.end(),
+            [&nameID](const VariableData &var){ return var.nameID == nameID; });
+
+        return {iter != localVars.end(),
+                std::distance(localVars.begin(), iter)};
     }
     const VariableData &getVar(unsigned int idx) const
     {
         assert(idx < localVars.size());
         return localVars[idx];
     }
-};
-struct LocalScopeManager
-{
-protected:
-    std::stack<LocalScopeFrame> locScopeFrames;
-    void addNewFrame()
-    {
-        // pushing empty
-        locScopeFrames.push({});
-    }
-    // ScopeTypes scopeType, 
-    void addScopeFramesTopVar(unsigned int nameID, LangDataTypes valueType)
-    {
-        assert(!locScopeFrames.empty());
-        locScopeFrames.top().addVar(nameID, valueType);
-    }
-    bool popScopeFramesTop()
-    {   
-        if (locScopeFrames.empty())
-            return false;
-        locScopeFrames.pop();
-        return true;
-    }
-    LocalScopeFrame &getScopeFramesTop()
-    {
-        assert(!locScopeFrames.empty());
-        return locScopeFrames.top();
-    }
-
-    std::tuple<bool, unsigned int> containsLocalVar(unsigned int nameID)
-    {
-        assert(!locScopeFrames.empty());
-        return locScopeFrames.top().containsVar(nameID);
-    }
-    const VariableData &getLocalVar(unsigned int idx) const
-    {
-        assert(!locScopeFrames.empty());
-        return locScopeFrames.top().getVar(idx);
-    }
 
     unsigned int getNumOfLocals() const
     {
-        // TODO: this approach assumes no nested local scopes withing a function
-        // (although there is a stack).
-        // Need to change if we want to support them.
-        return locScopeFrames.top().getNumOfLocals();
+        return localVars.size();
     }
 };
 
@@ -116,7 +87,7 @@ public:
     }
 };
 
-struct FunctionData : public LocalScopeManager, public IDable
+struct FunctionData : public IDable
 {
     unsigned int nameID = 0;
     bool isMethod = false;
@@ -124,29 +95,24 @@ struct FunctionData : public LocalScopeManager, public IDable
     LangDataTypes ldType_ret;
     std::vector<VariableData> argVars;
 
+    // recorded once the function's locals are declared
+    unsigned int numOfLocals = 0;
+
 public:
     FunctionData() 
-    {
-        addNewFrame();
-    }
+    {}
     FunctionData(unsigned int nameID, LangDataTypes ldType_ret, bool isMethod = false) 
         : nameID(nameID), isMethod(isMethod), ldType_ret(ldType_ret)
-    {
-        addNewFrame();
-    }
+    {}
 
     void addPar(unsigned int nameID, LangDataTypes ldType_par)
     {
         argVars.emplace_back(nameID, ldType_par);
     }
 
-    void addLocalScopeFramesTopVar(unsigned int nameID, LangDataTypes valueType)
-    {
-        addScopeFramesTopVar(nameID, valueType);
-    }
-    bool popLocalScopeFramesTop()
+    void setNumOfLocals(unsigned int num)
     {
-        return popScopeFramesTop();
+        numOfLocals = num;
     }
 
     std::tuple<bool, unsigned int> containsArg(unsigned int identNameID)
@@ -157,20 +123,12 @@ public:
         return {iter != argVars.end(), 
                 std::distance(argVars.begin(), iter)};
     }
-    std::tuple<bool, unsigned int> containsLocal(unsigned int identNameID)
-    {
-        return containsLocalVar(identNameID);
-    }
 
     const VariableData &getArgVar(unsigned int ID) const 
     {
         assert(ID < argVars.size());
         return argVars[ID];
     }
-    const VariableData &getLocalVar(unsigned int idx) const 
-    {
-        return LocalScopeManager::getLocalVar(idx);
-    }
 
     unsigned int getNumOfPars() const
     {
@@ -179,7 +137,7 @@ public:
 
     unsigned int getNumOfLocals() const
     {
-        return LocalScopeManager::getNumOfLocals();
+        return numOfLocals;
     }
 };
 
@@ -195,7 +153,7 @@ private:
     bool ctorAdded = false;
     std::vector<FunctionData> funcs;
     std::vector<VariableData> fieldVars;
-    static std::vector<VariableData> staticVars;
+    std::vector<VariableData> staticVars;
 public:
     void setIsDefined(bool isDefined)
     {
@@ -225,11 +183,10 @@ public:
         return (LangDataTypes)getID();
     }
 
-    FunctionData *getLastFunc()
+    FunctionData *getFunc(unsigned int funcID)
     {
-        if (funcs.empty())
-            return NULL;
-        return &(funcs.back());
+        assert(funcID < funcs.size());
+        return &(funcs[funcID]);
     }
 
     const FunctionData &getFuncByID(unsigned int funcID)
@@ -257,19 +214,11 @@ public:
         return true;
     }
 
-    void addFuncPar(unsigned int nameID, LangDataTypes ldType_par)
-    {
-        if (!funcs.empty())
-        {
-            funcs.back().addPar(nameID, ldType_par);
-        }
-    }
-
     void addFieldVar(unsigned int nameID, LangDataTypes valueType)
     {
         fieldVars.emplace_back(nameID, valueType);
     }
-    void addStaticVar(unsigned int nameID, LangDataTypes valueType) const
+    void addStaticVar(unsigned int nameID, LangDataTypes valueType)
     {
         staticVars.emplace_back(nameID, valueType);
     }
@@ -304,12 +253,72 @@ public:
 
     const VariableData &getStaticVar(unsigned int idx) const
     {
-        assert(idx < fieldVars.size());
-        return fieldVars[idx];
+        assert(idx < staticVars.size());
+        return staticVars[idx];
     }
 
 };
 
-inline std::vector<VariableData> ClassData::staticVars;
+// All classes of the program, shared by the parsers of all files.
+// Classes are only ever added, and a deque doesn't move the existing
+// ones when growing, so references to them stay valid.
+class ClassTable
+{
+private:
+    std::deque<ClassData> classes;
+    std::unordered_map<unsigned int, unsigned int> classIdxByName;
+    // guards the containers only, the contents of a class
+    // are filled in by the parser of the file defining it
+    mutable std::shared_mutex mutex;
+
+public:
+    ClassTable() = default;
+
+    // the classes as they are now, to build on separately
+    ClassTable(const ClassTable &other)
+    {
+        std::shared_lock<std::shared_mutex> lock(other.mutex);
+        classes = other.classes;
+        classIdxByName = other.classIdxByName;
+    }
+    ClassTable &operator=(const ClassTable &other) = delete;
+
+    std::tuple<bool, unsigned int> find(unsigned int nameID) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto iter = classIdxByName.find(nameID);
+        if (iter == classIdxByName.end())
+            return {false, classes.size()};
+        return {true, iter->second};
+    }
+
+    // checking and adding in one step, so that two files
+    // referring to a new class don't add it twice
+    unsigned int findOrAdd(unsigned int nameID)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto [iter, inserted] = classIdxByName.try_emplace(nameID, classes.size());
+        if (inserted)
+        {
+            auto &newClass = classes.emplace_back(nameID);
+            newClass.setID(iter->second);
+        }
+        return iter->second;
+    }
+
+    ClassData &getByID(unsigned int classID)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        assert(classID < classes.size());
+        assert(classID == classes[classID].getID());
+        return classes[classID];
+    }
+
+    size_t size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return classes.size();
+    }
+};
 
 #endif
\ No newline at end of file
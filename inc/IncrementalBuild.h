@@ -0,0 +1,34 @@
+#ifndef _INCREMENTAL_BUILD_
+#define _INCREMENTAL_BUILD_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "JackCompilerTypes.h"
+#include "CompileDriver.h"
+#include "BuildRecords.h"
+#include "ThreadPool.h"
+#include "DEBUG_CONTROL.h"
+
+// Builds the same files over and over (--watch), generating only what
+// is out of date according to the build records, which stay in memory
+// between the builds and are saved after each. Everything is still
+// lexed (unchanged files from the cache) and goes through phase 1,
+// which is cheap and gives every build a consistent class table.
+// In the files generated, the unchanged functions come from the cache.
+class IncrementalBuild
+{
+private:
+    CompilerOptions options;
+    ThreadPool &pool;
+    CompileCaches caches;
+    BuildRecords records;
+
+public:
+    IncrementalBuild(const CompilerOptions &options, ThreadPool &pool);
+
+    bool build(const std::vector<std::string> &filePaths, std::ostream &out, std::ostream &err);
+};
+
+#endif
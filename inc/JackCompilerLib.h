@@ -0,0 +1,40 @@
+#ifndef _JACK_COMPILER_LIB_
+#define _JACK_COMPILER_LIB_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "JackCompilerTypes.h"
+
+class ThreadPool;
+
+// source name -> Jack source text
+typedef std::map<std::string, std::string> jackSourcesMap;
+
+struct JackDiagnostic
+{
+    std::string sourceName;
+    std::string message;
+};
+
+struct JackCompileResult
+{
+    // every source was parsed to the end
+    bool success = false;
+    // output name (source name without directories
+    // and the .jack extension) -> VM code
+    std::map<std::string, std::string> vmCode;
+    std::vector<JackDiagnostic> diagnostics;
+};
+
+// Compiles the sources as one program, the libraries (OS classes)
+// are passed in as sources too. Nothing is read from or written to
+// the filesystem and nothing is logged, so it can be called from
+// any number of threads at once. Without a pool a temporary one
+// of options.jobs threads is used. A source that doesn't parse
+// fails with its diagnostics, the others are still compiled.
+JackCompileResult jackCompile(const jackSourcesMap &sources,
+    const CompilerOptions &options = CompilerOptions(), ThreadPool *pool = NULL);
+
+#endif
@@ -11,6 +11,93 @@ struct TokenData;
 
 typedef std::vector<TokenData> tokensVect;
 typedef std::vector<std::string> identifierVect;
-typedef std::map<std::string, TokenTypes>::iterator tokenMapIter;
+typedef std::map<std::string, TokenTypes>::const_iterator tokenMapIter;
+
+// What one file may take, a file over any of them fails with
+// a diagnostic and the rest are compiled as usual. 0: no limit
+struct ResourceLimits
+{
+    // bytes of source, --max-file-size
+    size_t maxFileSize = 0;
+    // --max-tokens
+    size_t maxTokens = 0;
+    // the AST nodes alive at once, --max-ast-nodes
+    size_t maxAstNodes = 0;
+    // of the (), [] and {} brackets, --max-depth
+    size_t maxNestingDepth = 0;
+    // lexing, parsing and generating the file together
+    // (reading and writing it not included), --max-file-ms
+    size_t maxFileMs = 0;
+};
+
+struct CompilerOptions
+{
+    // generate code while parsing (no AST kept),
+    // for builds that don't need anything done on the tree
+    bool directEmit = false;
+    // threads used for the work that can run in parallel,
+    // including the main one, -j N
+    unsigned int jobs = 1;
+    // where the .vm files are written, the working directory if empty
+    std::string outDir;
+    // generate every file, not only the out of date ones, --rebuild
+    bool rebuildAll = false;
+    // files read and written in batches with io_uring if the kernel
+    // has it, otherwise (or with --no-io-uring) on the thread pool
+    bool ioUring = true;
+    // print the class graph the files are scheduled by, its
+    // waves and critical path, --schedule-report
+    bool scheduleReport = false;
+    // print the sizes the build went through, how often the buffers
+    // outgrew their estimates and the heap allocations, --stats
+    bool stats = false;
+    // wall and CPU time of every stage, per file and in total, the
+    // throughput and the parser's states, --time-report
+    bool timeReport = false;
+    ResourceLimits limits;
+};
+
+// Which files under the source roots are compiled
+struct DiscoveryOptions
+{
+    // the whole trees, not only the files directly
+    // in the directories, --recursive
+    bool recursive = false;
+    // globs on the paths relative to their root, for the ones without
+    // a '/' only the name. '*' and '?' stop at a '/', "**" doesn't.
+    // A file is taken if it matches an include (or there are none)
+    // and no exclude, an excluded directory isn't walked.
+    // --include <glob>, --exclude <glob>
+    std::vector<std::string> includes;
+    std::vector<std::string> excludes;
+};
+
+struct CompilerArgs
+{
+    const char *srcPath = NULL;
+    const char *libsPath = NULL;
+    // --src <path>: more source roots, after the first
+    std::vector<const char*> moreSrcPaths;
+    DiscoveryOptions discovery;
+    // --serve <socket>: run as a compile server
+    const char *servePath = NULL;
+    // --connect <socket>: have the server compile instead
+    const char *connectPath = NULL;
+    // --watch: build again whenever a source changes
+    bool watch = false;
+    // --batch <manifest>: compile the projects it lists
+    // against the libraries, the only path given
+    const char *batchPath = NULL;
+    // --pipe: the classes from stdin, the code to stdout,
+    // the libraries the only path given
+    bool pipe = false;
+    // --shards N: generate in N worker processes
+    unsigned int shards = 0;
+    // --stream: lex and generate the files function by function
+    bool stream = false;
+    // --trace-out <file>: the build's trace events, written when it ends
+    const char *traceOutPath = NULL;
+    CompilerOptions options;
+};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef _LEXER_
+#define _LEXER_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "JackCompilerTypes.h"
+#include "LexerTypes.h"
+#include "UsefulString.h"
+#include "DEBUG_CONTROL.h"
+
+class Lexer
+{
+private:
+    std::string curLine;
+    bool moreLinesComing = true;
+
+    std::string curFileName;
+
+    // echo of the lexed lines, files lexed in parallel
+    // get their own, printed in file order afterwards
+    std::ostream &logStrm;
+
+    // nothing is checked without limits
+    const ResourceLimits *limits = NULL;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    // of the brackets open, and the most that have been
+    // at once, for limits->maxNestingDepth
+    size_t nestingDepth = 0;
+    size_t deepestNesting = 0;
+    // the limit the file is over, the lexing stops at
+    // the line it's found on, empty if none
+    std::string limitHit;
+
+    bool checkLimits(const LexerState &lexState);
+
+public:
+    explicit Lexer(std::ostream &logStrm = std::cout) : logStrm(logStrm)
+    {}
+
+    std::ostream &log()
+    {
+        return logStrm;
+    }
+
+    bool getMoreLinesComing() const
+    {
+        return moreLinesComing;
+    }
+
+    void setCurFileName(std::string curFilePath);
+
+    const std::string &getCurFileName() const
+    {
+        return curFileName;
+    }
+
+    void resetForFile()
+    {
+        moreLinesComing = true;
+        nestingDepth = 0;
+        deepestNesting = 0;
+        limitHit.clear();
+    }
+
+    // the tokens and the nesting are checked as they come,
+    // the time after every line
+    void setLimits(const ResourceLimits &limitsPar, std::chrono::steady_clock::time_point deadlinePar)
+    {
+        limits = &limitsPar;
+        deadline = deadlinePar;
+    }
+
+    const std::string &getLimitHit() const
+    {
+        return limitHit;
+    }
+
+    std::string getCurLine() const
+    {
+        return curLine;
+    }
+
+    bool lexNextLine(std::istream *jackSrc, LexerState &lexState);
+
+    void initStateBeh(UsefulString &ustr, LexerState &lexState);
+    void lettersStateBeh(UsefulString &ustr, LexerState &lexState);
+    void digitsAfterAlphaStateBeh(UsefulString &ustr, LexerState &lexState);
+    void digitsStateBeh(UsefulString &ustr, LexerState &lexState);
+
+    void handleBuffer(LexerState &lexState);
+
+    void symbolStateBeh(UsefulString &ustr, LexerState &lexState);
+
+    void commentStateBeh(UsefulString &ustr, LexerState &lexState);
+
+    void mlineCommentStateBeh(UsefulString &ustr, LexerState &lexState);
+
+    bool lexLine(const std::string &line, LexerState &lexState);
+};
+
+// all lines of jackSrc into lexState,
+// false if the lexer's limits stopped it
+bool tokenize(std::istream &jackSrc, Lexer &lexer, LexerState &lexState);
+
+bool tokenize(const std::string &filePath, Lexer &lexer, LexerState &lexState);
+
+// a file read beforehand, its contents in text
+bool tokenize(const std::string &filePath, const std::string &text, Lexer &lexer, LexerState &lexState);
+
+#endif
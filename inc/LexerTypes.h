@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <vector>
+#include <string>
 
 #include "JackCompilerTypes.h"
 #include "DEBUG_CONTROL.h"
@@ -23,13 +24,16 @@ class LexerState
 public:
     tokensVect tokens;
     identifierVect identifiers;
+    // taken out of tokens by a streaming reader, they
+    // still count for --max-tokens
+    size_t tokensDropped = 0;
 
     bool fsmFinished = false;
     LexFsmStates fsmCurState = LexFsmStates::sINIT;
     bool commentOpen = false;
     bool mlineComment = false;
-    char buffer[20];
-    uint8_t bIdx = 0;
+    // the identifier, keyword or number being read, as long as it gets
+    std::string buffer;
     int lexedLineIdx = 0;
     
     // Whether the last oper or term token
@@ -39,8 +43,11 @@ public:
     bool lastOperTermIsOper = true;
     bool onRhs = false;
 
+    // the tokens' buffer given back, once they're parsed
+    void releaseTokens();
+
     void flush();
-    bool addBuff(char c);
+    void addBuff(char c);
     bool buffEmpty();
     void reset();
 };
@@ -125,7 +132,7 @@ enum class TokenTypes : unsigned int
 };
 
 #if defined(LEXER_DEBUG) || defined(ERR_DEBUG)
-inline std::map<TokenTypes, std::string> tTypes_to_strings 
+inline const std::map<TokenTypes, std::string> tTypes_to_strings 
 {
     {TokenTypes::tCLASS, "CLASS"},
     {TokenTypes::tCONSTRUCTOR, "CONSTRUCTOR"},
@@ -187,7 +194,7 @@ inline const std::string &tType_to_string(TokenTypes tType)
 }
 #endif
 
-inline std::map<std::string, TokenTypes> tokenLookup
+inline const std::map<std::string, TokenTypes> tokenLookup
 {
     {"class", TokenTypes::tCLASS},
     {"constructor", TokenTypes::tCONSTRUCTOR},
@@ -293,7 +300,7 @@ inline bool isexprkeyword(TokenTypes tType)
 }
 
 #ifdef DEBUG
-inline std::string emptyStr("");
+inline const std::string emptyStr("");
 inline const std::string &tokenLookupFindByVal(TokenTypes tType)
 {
     for (auto it = tokenLookup.begin(); it != tokenLookup.end(); ++it)
@@ -8,28 +8,111 @@
 #include <cassert>
 #include <algorithm>
 #include <sstream>
+#include <chrono>
+#include <functional>
 
 #include "LexerTypes.h"
 #include "CheckerTypes.h"
 #include "ParserTypes.h"
 #include "GeneratorTypes.h"
+#include "Generator.h"
 #include "ArenaAllocator.h"
+#include "CompilerContext.h"
+#include "Trace.h"
 #include "DEBUG_CONTROL.h"
 
 // HELPER MACROS
-#define ALLOC_AST_NODE new (aralloc.allocate()) AstNode
+#define ALLOC_AST_NODE newAstNode
+
+// Streaming: called between the members of a class (classStart: before
+// a class), it may drop the tokens before curTokenId but the one
+// right before it, moving curTokenId along, and has to append at least
+// the next member and the token after it (unless the source ends)
+typedef std::function<void(tokensVect &tokens, unsigned int &curTokenId, bool classStart)> TokenFeed;
 
 class Parser
 {
 public:
     unsigned int thisNameID = 0;
 private:
-    // NOTE: IMPORTANT: 500 node limit so far
     ParserState pState;
 
     ArenaAllocator<AstNode> aralloc{ArenaAllocator<AstNode>(MAX_EXPTECTED_AST_NODES)};
     AstNode* astRoot = NULL;
 
+    // direct emission mode: code is generated as soon as
+    // a construct is finished, the AST is not kept
+    Generator *directGen = NULL;
+    // reused between emitFinishedNodes calls
+    std::vector<AstNode*> openPath;
+
+    // NULL if all the tokens are there from the start
+    const TokenFeed *tokenFeed = NULL;
+
+    // 0: no limit, see setLimits
+    // the unit's, for the limit messages
+    std::string filePath;
+    size_t maxAstNodes = 0;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    bool stoppedAtLimit = false;
+
+    StateVisits stateVisits{};
+
+    // see keepFuncKeys
+    bool funcKeysKept = false;
+    FuncCodeCache::FuncKeys funcKeys;
+    // the function being parsed: its first token and
+    // the signatures of the subroutines it calls
+    unsigned int funcStartTokenId = 0;
+    FuncCodeCache::Key funcCallees;
+
+    // the class and function trace events begun and not yet ended
+    unsigned int traceOpen = 0;
+
+    void traceParserBegin(const char *category, const std::string &name)
+    {
+        if (!getTracing())
+            return;
+        traceBegin(category, name);
+        traceOpen++;
+    }
+
+    void traceParserEnd()
+    {
+        if (traceOpen == 0)
+            return;
+        traceEnd();
+        traceOpen--;
+    }
+
+    // terminates the FSM if a limit is hit
+    bool checkLimits();
+
+    // malformed source: reported with the current token and the FSM
+    // terminated, so that a bad file fails on its own instead of the
+    // whole process. Reported by the bodies pass, the signature pass
+    // stops at the same place.
+    bool syntaxError(const char *expected);
+
+    // of the name, not its id, the ids are the context's
+    uint64_t identHash(unsigned int nameID);
+    uint64_t typeHash(LangDataTypes ldType);
+
+    void addFuncCallee(int classID, unsigned int funcNameID, bool contains, unsigned int funcID);
+
+    // at the function's }, its tokens and what its code depends on
+    // outside of them: the callees added so far and its class's name
+    // and variables (indices and the types methods are called on)
+    void addFuncKey(const AstNode *funcNode);
+
+    template<typename... Args>
+    AstNode *newAstNode(Args&&... args)
+    {
+        AstNode *astNode = new (aralloc.allocate()) AstNode(std::forward<Args>(args)...);
+        astNode->nID = pState.nextNodeId();
+        return astNode;
+    }
+
     AstNode *createStackTopNode(ParserState &pState, TokenData &token);
 
     AstNode *createStackTopNode(ParserState &pState, AstNodeTypes aType, int aVal);
@@ -44,7 +127,23 @@ private:
 
     bool parseFuncPars(ParserState &pState);
 
+    // signature pass: jumps over a function body
+    bool skipFuncBody(ParserState &pState);
+
+    void emitFinishedNodes();
+
+    void emitFinishedChildren(AstNode *node, AstNode *openChild);
+
+    void feedTokens();
+
 public:
+    // the context's classes are shared by the parsers of all files
+    explicit Parser(CompilerContext &context) : thisNameID(context.getThisNameID()),
+        pState(context.getClassTable())
+    {
+        loadArrSysClass(context.getArrayLibClassNameID());
+    }
+
     void loadArrSysClass(unsigned int arrayLib_className_id);
 
     bool initStateBeh(ParserState &pState);
@@ -108,7 +207,86 @@ public:
 
     bool varAssignStateBeh(ParserState &pState);
 
-    AstNode *buildAST(tokensVect &tokens, identifierVect &identifiers, unsigned int tokenOffset);
+    // the tokens are only used until it returns
+    AstNode *buildAST(tokensVect &tokens, const identifierVect &identifiers, unsigned int tokenOffset);
+
+    // NULL turns direct emission off
+    void setDirectEmission(Generator *generator)
+    {
+        directGen = generator;
+    }
+
+    // NULL turns streaming off. The tokens given to buildAST
+    // are the feed's window, they can start out empty.
+    void setTokenFeed(const TokenFeed *feed)
+    {
+        tokenFeed = feed;
+    }
+
+    // checked before every step of the FSM, a step can go over
+    // them by at most the nodes (or the time) of one statement
+    void setLimits(const std::string &filePathPar, size_t maxAstNodesPar,
+        std::chrono::steady_clock::time_point deadlinePar)
+    {
+        filePath = filePathPar;
+        maxAstNodes = maxAstNodesPar;
+        deadline = deadlinePar;
+    }
+
+    void setParsePass(ParsePasses parsePass)
+    {
+        pState.setParsePass(parsePass);
+    }
+
+    void setStreams(std::ostream &logStrm, std::ostream &errStrm)
+    {
+        pState.setStreams(logStrm, errStrm);
+    }
+
+    // the bodies pass makes the keys the function code
+    // cache is looked up by, for the functions it finishes
+    void keepFuncKeys()
+    {
+        funcKeysKept = true;
+    }
+
+    const FuncCodeCache::FuncKeys &getFuncKeys() const
+    {
+        return funcKeys;
+    }
+
+    bool getFinishedCorrectly() const
+    {
+        return pState.fsmFinishedCorrectly;
+    }
+
+    bool getStoppedAtLimit() const
+    {
+        return stoppedAtLimit;
+    }
+
+    // of all the buildAST calls
+    const StateVisits &getStateVisits() const
+    {
+        return stateVisits;
+    }
+
+    // room for numNodes before the first one is made
+    void reserveAstNodes(size_t numNodes)
+    {
+        aralloc.reserve(numNodes);
+    }
+
+    // all the nodes made, released ones too
+    size_t getNumAstNodes() const
+    {
+        return pState.getNumNodeIds();
+    }
+
+    const std::set<std::pair<unsigned int, unsigned int>> &getUsedFuncs() const
+    {
+        return pState.getUsedFuncs();
+    }
 
     void resetState()
     {
@@ -116,29 +294,29 @@ public:
     }
 
 #ifdef DEBUG
-void printAST()
+void printAST(std::ostream &strm = std::cout)
 {
     if (astRoot == NULL)
         return;
-    std::cout << '\n';
-    printAST(astRoot);
+    strm << '\n';
+    printAST(astRoot, strm);
 }
-void printAST(AstNode *curRoot)
+void printAST(AstNode *curRoot, std::ostream &strm)
 {
     // pre-order
-    curRoot->print();
+    curRoot->print(strm);
     for (auto childNode : curRoot->nChildNodes)
     {
-        printAST(childNode);
+        printAST(childNode, strm);
     }
 }
-void printASTpost(AstNode *curRoot)
+void printASTpost(AstNode *curRoot, std::ostream &strm)
 {
     for (auto childNode : curRoot->nChildNodes)
     {
-        printASTpost(childNode);
+        printASTpost(childNode, strm);
     }
-    curRoot->print();
+    curRoot->print(strm);
 }
 #endif
 };
@@ -1,7 +1,9 @@
 #ifndef _PARSER_TYPES_
 #define _PARSER_TYPES_
 
+#include <array>
 #include <stack>
+#include <set>
 #include <iostream>
 #include <tuple>
 #include <variant>
@@ -14,6 +16,7 @@
 #define LAYER_INCR 10
 #define LAYER_DECR LAYER_INCR
 
+// the AST arena grows by blocks of this many nodes
 #define MAX_EXPTECTED_AST_NODES 500
 
 // preliminary, some will go away
@@ -117,7 +120,7 @@ enum class AstNodeTypes : unsigned int
 };
 
 #if defined(DEBUG) || defined(PARSER_DEBUG)
-inline std::map<AstNodeTypes, std::string> aTypes_to_strings
+inline const std::map<AstNodeTypes, std::string> aTypes_to_strings
 {
     {AstNodeTypes::aCLASS, "CLASS"},
     {AstNodeTypes::aCONSTRUCTOR, "CONSTRUCTOR"},
@@ -200,7 +203,7 @@ inline const std::string &aType_to_string(AstNodeTypes aType)
 }
 #endif
 
-inline std::map<TokenTypes, AstNodeTypes> tTypes_to_aTypes
+inline const std::map<TokenTypes, AstNodeTypes> tTypes_to_aTypes
 {
     {TokenTypes::tCLASS, AstNodeTypes::aCLASS},
     {TokenTypes::tCONSTRUCTOR, AstNodeTypes::aCONSTRUCTOR},
@@ -245,7 +248,7 @@ inline std::map<TokenTypes, AstNodeTypes> tTypes_to_aTypes
 
 inline AstNodeTypes tType_to_aType(TokenTypes tType)
 {
-    std::map<TokenTypes, AstNodeTypes>::iterator iter;
+    std::map<TokenTypes, AstNodeTypes>::const_iterator iter;
     iter = tTypes_to_aTypes.find(tType);
 
     if (iter != tTypes_to_aTypes.end())
@@ -284,8 +287,31 @@ enum class ParseFsmStates : unsigned int
     sFUNC_DO_CALL,
     sRETURN
 };
+inline constexpr size_t numParseFsmStates = (size_t)ParseFsmStates::sRETURN + 1;
 
-inline std::map<TokenTypes, int> precedLookup
+inline const char *parseFsmStateName(ParseFsmStates state)
+{
+    static const char *const names[numParseFsmStates] = {
+        "sINIT", "sSTATEMENT_DECIDE", "sWHILE", "sBLOCK_CLOSE", "sIF", "sELSE", "sEXPR",
+        "sVAR_DECL", "sVAR_ASSIGN", "sCLASS_DECIDE", "sFIELD_DECL", "sSTATIC_DECL",
+        "sCTOR_DEF", "sFUNC_DEF", "sMETHOD_DEF", "sFUNC_DO_CALL", "sRETURN"
+    };
+    return names[(size_t)state];
+}
+
+// how often buildAST went through each state, for --time-report
+typedef std::array<size_t, numParseFsmStates> StateVisits;
+
+// Files are parsed twice: first only for what other files can refer to
+// (classes, fields, statics, function signatures), function bodies are
+// skipped; then for the bodies, with all the signatures of the program known.
+enum class ParsePasses : unsigned int
+{
+    ppSIGNATURES = 0,
+    ppBODIES
+};
+
+inline const std::map<TokenTypes, int> precedLookup
 {
     {TokenTypes::tEQUAL, 3},
     {TokenTypes::tACCESS, 7},
@@ -341,12 +367,6 @@ private:
             aType != AstNodeTypes::aROOT &&
             aType != AstNodeTypes::aCLASS;
     }
-    static int assignId()
-    {
-        static int idPool = 0;
-        return idPool++;
-    }
-    
     // moved to private to not mess with pointer
     AstNode *parentNode = NULL;
 
@@ -357,8 +377,11 @@ public:
 
     std::vector<AstNode*> nChildNodes;
     int nPrecCoeff = 0;      // relevant for operators only
-    int nID = 0;
+    int nID = 0;             // unique within the parsed file, see ParserState
     bool generatesCode = false;
+    // direct emission mode: how many of the children
+    // have had their code generated already
+    unsigned int nEmittedChildren = 0;
     
     explicit AstNode(TokenData &token);
 
@@ -398,7 +421,7 @@ public:
     void addChildConditional(AstNode *child);
 
 #if defined(DEBUG) || defined(PARSER_DEBUG)
-    void print();
+    void print(std::ostream &strm = std::cout);
 #endif
 
 private:
@@ -463,12 +486,6 @@ inline bool greaterPreced(const AstNode &t1, const AstNode &t2)
     return (itr1->second + t1.nPrecCoeff > itr2->second + t2.nPrecCoeff);
 }
 
-inline int getLabelId()
-{
-    static int labelId = 0;
-    return labelId++;
-}
-
 inline bool isblockstart(AstNodeTypes aType)
 {
     return aType == AstNodeTypes::aWHILE 
@@ -481,12 +498,30 @@ class ParserState
 {
 private:
     tokensVect *tokens;
-    identifierVect *identifiers;
+    const identifierVect *identifiers;
     unsigned int curTokenId = 0;
     bool tokensFinished = false;
+    ParsePasses parsePass = ParsePasses::ppSIGNATURES;
+    // shared between the parsers of all files
+    ClassTable &classTable;
     ClassData *curParseClass = NULL;
+    // idx in curParseClass funcs, -1 outside of functions
+    int curParseFuncID = -1;
+    FuncLocals funcLocals;
     int layerCoeff = 0;
     int arrayEnteryNum = 0;
+    // no process-wide counters, so that the output of a function
+    // (labels) only depends on its own source
+    int nodeIdPool = 0;
+    int labelIdPool = 0;
+    // debug output and error reports,
+    // not touched by resetNonShared
+    std::ostream *logStrm = &std::cout;
+    std::ostream *errStrm = &std::cerr;
+    // (class name id, function name id) of the functions of other
+    // classes the bodies call, found or not, what the generated
+    // code depends on outside of the file
+    std::set<std::pair<unsigned int, unsigned int>> usedFuncs;
 
 public:
     bool fsmFinished = false;
@@ -494,16 +529,42 @@ public:
     ParseFsmStates fsmCurState = ParseFsmStates::sINIT;
 
     std::stack<AstNode*> pendParentNodes;
-    std::vector<ClassData> classes;
 
     bool declaringLocals = false;
 
     // TODO: not needed?
     unsigned int arrayLib_classID = 0;
 
-    inline const std::vector<ClassData> &getClasses() const
+    inline ParsePasses getParsePass() const
+    {
+        return parsePass;
+    }
+    inline void setParsePass(ParsePasses parsePassPar)
+    {
+        parsePass = parsePassPar;
+    }
+
+    inline std::ostream &log()
+    {
+        return *logStrm;
+    }
+    inline std::ostream &err()
+    {
+        return *errStrm;
+    }
+    inline void setStreams(std::ostream &logStrmPar, std::ostream &errStrmPar)
     {
-        return classes;
+        logStrm = &logStrmPar;
+        errStrm = &errStrmPar;
+    }
+
+    inline void addUsedFunc(unsigned int classNameID, unsigned int funcNameID)
+    {
+        usedFuncs.emplace(classNameID, funcNameID);
+    }
+    inline const std::set<std::pair<unsigned int, unsigned int>> &getUsedFuncs() const
+    {
+        return usedFuncs;
     }
 
     ClassData &getClassByID(int classID = -1);
@@ -535,8 +596,11 @@ public:
     
     FunctionData *getCurParseFunc() const;
     void addCurParseFuncPar(unsigned int nameID, LangDataTypes ldType_par);
-    void addLocalScopeFramesTopVar(unsigned int nameID, LangDataTypes valueType);
-    bool popLocalScopeFramesTop();
+    void addCurParseFuncLocal(unsigned int nameID, LangDataTypes valueType);
+    // the function's body is closed, its locals are dropped
+    void closeCurParseFuncLocals();
+    // records the current function's number of locals and returns it
+    unsigned int recordCurParseFuncLocals();
 
     std::tuple<bool, unsigned int> containsArg(int identNameID);
     std::tuple<bool, unsigned int> containsLocal(int identNameID);
@@ -548,11 +612,11 @@ public:
     const VariableData &getFieldVar(unsigned int idx) const;
     const VariableData &getStaticVar(unsigned int idx) const;
 
-    ParserState();
+    explicit ParserState(ClassTable &classTable);
 
     void setTokens(tokensVect *tokensPar);
 
-    void setIdentifiers(identifierVect *identifiersPar);
+    void setIdentifiers(const identifierVect *identifiersPar);
 
     void resetNonShared();
 
@@ -562,6 +626,11 @@ public:
     inline void resetLayer() {layerCoeff = 0;}
     inline void restoreLayer(int storedLayer) { layerCoeff = storedLayer; }
 
+    inline int nextNodeId() {return nodeIdPool++;}
+    inline int getNumNodeIds() const {return nodeIdPool;}
+    // reset for every function
+    inline int nextLabelId() {return labelIdPool++;}
+
     inline int getArrayEnteryNum() {return arrayEnteryNum;}
     inline void incArrayEnteryNum() {arrayEnteryNum++;}
     inline void decArrayEnteryNum() {arrayEnteryNum--;}
@@ -604,6 +673,10 @@ public:
     {
         curTokenId = curTokenIdPar;
     }
+    inline unsigned int getCurTokenID() const
+    {
+        return curTokenId;
+    }
     
     inline TokenData &getCurToken()
     {
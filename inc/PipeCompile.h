@@ -0,0 +1,33 @@
+#ifndef _PIPE_COMPILE_
+#define _PIPE_COMPILE_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "JackCompilerTypes.h"
+#include "ThreadPool.h"
+#include "DEBUG_CONTROL.h"
+
+// One class of a stream, blank lines in front of it keep
+// the line numbers the stream's
+struct StreamClass
+{
+    std::string name;
+    std::string text;
+};
+
+// Cuts a stream of classes where a class starts outside of any braces,
+// comments and strings. Anything before the first class goes with it.
+std::vector<StreamClass> splitClasses(const std::string &stream);
+
+// --pipe: the classes of the stream on in compiled with the libraries
+// (read from libsPaths) as one program, in memory. out gets every
+// output as a frame, a header line "@@ <name>.vm <size>" followed by
+// exactly size bytes of code, the libraries' first, in stream order.
+// Only the diagnostics go to err, nothing is logged.
+bool pipeCompile(const CompilerOptions &options, const DiscoveryOptions &discovery,
+    ThreadPool &pool, const std::vector<std::string> &libsPaths,
+    std::istream &in, std::ostream &out, std::ostream &err);
+
+#endif
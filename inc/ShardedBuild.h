@@ -0,0 +1,21 @@
+#ifndef _SHARDED_BUILD_
+#define _SHARDED_BUILD_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "JackCompilerTypes.h"
+#include "DEBUG_CONTROL.h"
+
+// --shards N: the coordinator lexes the files and runs phase 1 itself,
+// then forks N worker processes, each generating a shard of the out
+// of date files against the symbols it inherits from the coordinator.
+// A worker compiles its files one by one and reports every one back,
+// one that dies only fails the file it was compiling, a new worker
+// takes over the rest of its shard.
+// The outputs and the records are the ones the in-process build makes.
+bool shardedCompile(const CompilerOptions &options, const std::vector<std::string> &filePaths,
+    unsigned int numShards, std::ostream &out, std::ostream &err);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _SIZE_ESTIMATES_
+#define _SIZE_ESTIMATES_
+
+#include <cstddef>
+
+// What a file's buffers are reserved at up front, so that they
+// don't grow by reallocating. Measured on the sample programs and
+// the OS libraries (45 files): per source byte 0.23 tokens (0.25 for
+// 9 in 10 files) and 0.022 identifiers (0.036), per token 0.58 AST
+// nodes (at most 0.71) and 6 bytes of VM code (at most 8.1).
+// The ratios below are above those for most files, --stats
+// tells how many buffers still had to grow.
+inline size_t estimateTokens(size_t sourceBytes)
+{
+    return sourceBytes / 4 + 16;
+}
+
+inline size_t estimateIdentifiers(size_t sourceBytes)
+{
+    return sourceBytes / 24 + 8;
+}
+
+inline size_t estimateAstNodes(size_t numTokens)
+{
+    return numTokens * 3 / 4 + 16;
+}
+
+inline size_t estimateVmBytes(size_t numTokens)
+{
+    return numTokens * 9 + 64;
+}
+
+#endif
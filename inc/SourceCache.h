@@ -0,0 +1,57 @@
+#ifndef _SOURCE_CACHE_
+#define _SOURCE_CACHE_
+
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+#include <filesystem>
+
+#include "LexerTypes.h"
+#include "DEBUG_CONTROL.h"
+
+struct SourceUnit;
+
+// What tells a changed file from an unchanged one
+struct FileStamp
+{
+    std::filesystem::file_time_type modTime;
+    uintmax_t size = 0;
+
+    bool operator==(const FileStamp &other) const
+    {
+        return modTime == other.modTime && size == other.size;
+    }
+
+    static bool read(const std::string &filePath, FileStamp &stamp);
+};
+
+// Lexed files kept between compilations (by the server), a file
+// is lexed again only once its stamp changes. Tokens are stored
+// before their identifiers are merged into a compilation's table,
+// every compilation merges its own copy. Safe to share between
+// compilations running concurrently.
+class SourceCache
+{
+private:
+    struct Entry
+    {
+        FileStamp stamp;
+        std::string name;
+        LexerState lexState;
+        std::string lexLog;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    mutable std::shared_mutex entriesMutex;
+
+public:
+    // stamp is set to the file's current one either way,
+    // false if the unit has to be lexed
+    bool fetch(SourceUnit &unit, FileStamp &stamp) const;
+
+    void store(const SourceUnit &unit, const FileStamp &stamp);
+
+    void erase(const std::string &filePath);
+};
+
+#endif
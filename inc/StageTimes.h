@@ -0,0 +1,100 @@
+#ifndef _STAGE_TIMES_
+#define _STAGE_TIMES_
+
+#include <array>
+#include <chrono>
+#include <time.h>
+
+#include "DEBUG_CONTROL.h"
+
+// The stages --time-report tells apart
+enum class BuildStages : unsigned int
+{
+    bsDISCOVERY = 0,
+    bsREAD,
+    bsLEX,
+    bsPARSE,
+    bsCODEGEN,
+    bsWRITE
+};
+inline constexpr size_t numBuildStages = (size_t)BuildStages::bsWRITE + 1;
+
+inline const char *buildStageName(BuildStages stage)
+{
+    static const char *const names[numBuildStages] = {
+        "discovery", "read", "lex", "parse", "codegen", "write"
+    };
+    return names[(size_t)stage];
+}
+
+// wall clock and CPU time of some work
+struct StageTime
+{
+    std::chrono::nanoseconds wall{0};
+    std::chrono::nanoseconds cpu{0};
+
+    StageTime &operator+=(const StageTime &other)
+    {
+        wall += other.wall;
+        cpu += other.cpu;
+        return *this;
+    }
+    StageTime operator-(const StageTime &other) const
+    {
+        return {wall - other.wall, cpu - other.cpu};
+    }
+};
+
+// per stage, of a unit or of a whole build
+struct StageTimes
+{
+    std::array<StageTime, numBuildStages> stages;
+
+    StageTime &operator[](BuildStages stage)
+    {
+        return stages[(size_t)stage];
+    }
+    const StageTime &operator[](BuildStages stage) const
+    {
+        return stages[(size_t)stage];
+    }
+};
+
+// Runs from its construction on. The CPU time is the calling thread's,
+// or with processCpu all threads' of the process (for the stages
+// that run on a pool as one batch).
+class StageTimer
+{
+private:
+    clockid_t cpuClock;
+    std::chrono::steady_clock::time_point wallStart;
+    std::chrono::nanoseconds cpuStart;
+
+    std::chrono::nanoseconds cpuNow() const
+    {
+        timespec ts{};
+        clock_gettime(cpuClock, &ts);
+        return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+    }
+
+public:
+    explicit StageTimer(bool processCpu = false)
+        : cpuClock(processCpu ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID),
+        wallStart(std::chrono::steady_clock::now()), cpuStart(cpuNow())
+    {}
+
+    std::chrono::steady_clock::time_point getWallStart() const
+    {
+        return wallStart;
+    }
+
+    StageTime elapsed() const
+    {
+        StageTime time;
+        time.wall = std::chrono::steady_clock::now() - wallStart;
+        time.cpu = cpuNow() - cpuStart;
+        return time;
+    }
+};
+
+#endif
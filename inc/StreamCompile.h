@@ -0,0 +1,24 @@
+#ifndef _STREAM_COMPILE_
+#define _STREAM_COMPILE_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "JackCompilerTypes.h"
+#include "ThreadPool.h"
+#include "DEBUG_CONTROL.h"
+
+// --stream: the files compiled as one program, none of them ever
+// held whole. A first pass over a file keeps only its identifiers and
+// the names of its classes. Phase 1 and phase 2 then lex it again as the
+// parser gets to each member of a class, phase 2 generating a function's
+// code and writing it out before the next one is lexed. Between two
+// functions only the class level symbols are kept, so the memory a file
+// needs is the one its biggest function does.
+// Every file is generated (directly, see --direct), nothing is logged.
+// The diagnostics go to err, --stats to out.
+bool streamCompile(const CompilerOptions &options, const std::vector<std::string> &filePaths,
+    ThreadPool &pool, std::ostream &out, std::ostream &err);
+
+#endif
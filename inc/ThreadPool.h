@@ -0,0 +1,63 @@
+#ifndef _THREAD_POOL_
+#define _THREAD_POOL_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <atomic>
+
+// Fixed set of worker threads running parallelFor jobs.
+// The calling thread works on its own job too, so a parallelFor
+// issued from inside a task cannot deadlock the pool, and a pool
+// of 1 thread (no workers) simply runs everything in the caller.
+class ThreadPool
+{
+private:
+    struct Job
+    {
+        // owned by the parallelFor caller, which waits for the job,
+        // not touched once all the tasks are taken
+        const std::function<void(size_t)> *func;
+        size_t numTasks;
+        std::atomic<size_t> nextTask{0};
+
+        std::mutex mutex;
+        std::condition_variable finishedCond;
+        size_t finishedTasks = 0;
+
+        Job(const std::function<void(size_t)> *func, size_t numTasks)
+            : func(func), numTasks(numTasks)
+        {}
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<Job>> pendingJobs;
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    bool stopping = false;
+
+    void workerLoop();
+    static void runTasks(Job &job);
+
+public:
+    // numThreads includes the calling thread
+    explicit ThreadPool(unsigned int numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &other) = delete;
+    ThreadPool &operator=(const ThreadPool &other) = delete;
+
+    unsigned int getNumThreads() const
+    {
+        return workers.size() + 1;
+    }
+
+    // calls func(0) ... func(numTasks - 1), returns when all are done
+    void parallelFor(size_t numTasks, const std::function<void(size_t)> &func);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _TRACE_
+#define _TRACE_
+
+#include <atomic>
+#include <string>
+
+#include "DEBUG_CONTROL.h"
+
+// --trace-out: begin and end events of the stages, the files, the classes
+// and the functions in the Chrome trace event format, which Perfetto
+// (and chrome://tracing) loads. Every thread records into a buffer of its
+// own, locked only when the thread records its first event, the buffers
+// are written out by writeTrace once the recording threads are done.
+// Process-wide, like the allocation counter.
+
+inline std::atomic<bool> tracingOn{false};
+
+inline bool getTracing()
+{
+    return tracingOn.load(std::memory_order_relaxed);
+}
+
+// events are recorded from here on, their times relative to now
+void startTracing();
+
+// only while tracing, category is a string literal, name is copied
+void traceBegin(const char *category, const std::string &name);
+// ends the last event the thread began
+void traceEnd();
+
+// all the threads' events as a JSON trace
+bool writeTrace(const std::string &path);
+
+// An event from construction to destruction, if tracing
+class TraceScope
+{
+private:
+    bool began;
+
+public:
+    TraceScope(const char *category, const std::string &name) : began(getTracing())
+    {
+        if (began)
+            traceBegin(category, name);
+    }
+
+    TraceScope(const TraceScope &other) = delete;
+    TraceScope &operator=(const TraceScope &other) = delete;
+
+    ~TraceScope()
+    {
+        if (began)
+            traceEnd();
+    }
+};
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef _USEFUL_STRING_
+#define _USEFUL_STRING_
+
 #include <iostream>
 #include <string>
 
@@ -8,7 +11,8 @@ private:
     int end;
     int cur;
     bool eol;
-    std::string str;
+    // not a copy, the string has to outlive it
+    const std::string &str;
 public:    
     UsefulString(const std::string &str) : str(str)
     {
@@ -121,4 +125,6 @@ public:
         return (str.substr(start, end - start + 1).compare(rhs.getStr().substr(rhs.getStart(),
             rhs.getEnd() - rhs.getStart() + 1)) == 0);
     }
-};
\ No newline at end of file
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef _VM_WRITER_
+#define _VM_WRITER_
+
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define VM_WRITER_INITIAL_CAPACITY 4096
+
+// "00" to "99", so that two digits are produced per division
+inline constexpr char digitPairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// All generated VM code of one output file goes into a single
+// contiguous buffer, which is written out with plain write() calls.
+// Appending doesn't allocate unless the buffer has to grow.
+class VmWriter
+{
+private:
+    std::vector<char> m_buffer;
+
+public:
+    VmWriter()
+    {
+        m_buffer.reserve(VM_WRITER_INITIAL_CAPACITY);
+    }
+
+    void append(const char *str, size_t len)
+    {
+        m_buffer.insert(m_buffer.end(), str, str + len);
+    }
+
+    void append(const std::string &str)
+    {
+        append(str.data(), str.size());
+    }
+
+    void appendInt(int value)
+    {
+        // filled from the end
+        char digits[12];
+        char *start = digits + sizeof(digits);
+
+        unsigned int absVal = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+        while (absVal >= 100)
+        {
+            const unsigned int pairIdx = (absVal % 100) * 2;
+            absVal /= 100;
+            *--start = digitPairs[pairIdx + 1];
+            *--start = digitPairs[pairIdx];
+        }
+        if (absVal >= 10)
+        {
+            *--start = digitPairs[absVal * 2 + 1];
+            *--start = digitPairs[absVal * 2];
+        }
+        else
+        {
+            *--start = (char)('0' + absVal);
+        }
+        if (value < 0)
+            *--start = '-';
+
+        append(start, digits + sizeof(digits) - start);
+    }
+
+    const char *data() const
+    {
+        return m_buffer.data();
+    }
+
+    size_t size() const
+    {
+        return m_buffer.size();
+    }
+
+    void clear()
+    {
+        m_buffer.clear();
+    }
+
+    void reserve(size_t capacity)
+    {
+        m_buffer.reserve(capacity);
+    }
+
+    // all of it, at the fd's position
+    bool writeToFd(int fd) const
+    {
+        size_t written = 0;
+        while (written < m_buffer.size())
+        {
+            ssize_t res = write(fd, m_buffer.data() + written, m_buffer.size() - written);
+            if (res < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            written += res;
+        }
+        return true;
+    }
+
+    bool writeToFile(const std::string &path) const
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+
+        if (!writeToFd(fd))
+        {
+            close(fd);
+            return false;
+        }
+        return close(fd) == 0;
+    }
+};
+
+#endif
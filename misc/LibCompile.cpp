@@ -0,0 +1,44 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "JackCompilerLib.h"
+
+// Usage: LibCompile <source.jack>...
+// Compiles the sources as one program through libjackc, the outputs
+// go to the working directory. The library mode of make check.
+int main(int argc, char *argv[])
+{
+    jackSourcesMap sources;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream srcFile(argv[i]);
+        if (!srcFile)
+        {
+            std::cerr << "Can't read " << argv[i] << '\n';
+            return 1;
+        }
+        std::ostringstream text;
+        text << srcFile.rdbuf();
+        sources[argv[i]] = text.str();
+    }
+
+    const JackCompileResult result = jackCompile(sources);
+    for (const auto &diagnostic : result.diagnostics)
+    {
+        std::cerr << diagnostic.message << '\n';
+    }
+
+    bool written = true;
+    for (const auto &[name, code] : result.vmCode)
+    {
+        std::ofstream outFile(name + ".vm", std::ios::binary);
+        outFile << code;
+        if (!outFile)
+        {
+            std::cerr << "Can't write " << name << ".vm\n";
+            written = false;
+        }
+    }
+    return result.success && written ? 0 : 1;
+}
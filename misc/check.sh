@@ -0,0 +1,72 @@
+#!/bin/bash
+# make check: compiles the samples in every mode of the compiler
+# and diffs the outputs against the ones of the default mode.
+# Usage: check.sh <JackCompiler> <LibCompile> <samples_path>
+
+compiler=$(realpath "$1")
+libCompile=$(realpath "$2")
+samples=$(realpath "$3")
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# the sources under their class names, the pipe names its outputs
+# after them. Array is built in, its library class doesn't compile.
+mkdir -p "$work/src" "$work/libs"
+for srcPath in "$samples"/*.jack; do
+    className=$(sed -n 's/^class \([A-Za-z_0-9]*\).*/\1/p' "$srcPath" | head -n 1)
+    cp "$srcPath" "$work/src/$className.jack"
+done
+for libPath in "$samples"/libs/*.jack; do
+    if [ "$(basename "$libPath")" != "Array.jack" ]; then
+        cp "$libPath" "$work/libs/"
+    fi
+done
+
+failed=0
+
+# runs the command in the mode's own directory
+runMode()
+{
+    local mode=$1
+    shift
+    mkdir -p "$work/$mode"
+    if ! (cd "$work/$mode" && "$@" > "$work/$mode.log" 2>&1); then
+        echo "FAILED: $mode"
+        cat "$work/$mode.log"
+        failed=1
+    fi
+}
+
+runMode default "$compiler" --rebuild "$work/src" "$work/libs"
+runMode direct "$compiler" --rebuild --direct "$work/src" "$work/libs"
+runMode stream "$compiler" --stream "$work/src" "$work/libs"
+runMode shards "$compiler" --rebuild --shards 2 "$work/src" "$work/libs"
+# the outputs come as frames, "@@ <name>.vm <size>" and then the code
+runMode pipe bash -o pipefail -c 'cat "$1"/src/*.jack | "$2" --pipe "$1/libs" |
+    awk "/^@@ /{ outPath = \$2; printf \"\" > outPath; next } { print > outPath }"' \
+    pipe "$work" "$compiler"
+runMode library "$libCompile" "$work"/src/*.jack "$work"/libs/*.jack
+
+numOutputs=$(ls "$work"/default/*.vm 2> /dev/null | wc -l)
+if [ "$numOutputs" -eq 0 ]; then
+    echo "FAILED: no outputs"
+    failed=1
+fi
+for mode in direct stream shards pipe library; do
+    if [ "$(ls "$work/$mode"/*.vm 2> /dev/null | wc -l)" -ne "$numOutputs" ]; then
+        echo "DIFFERENT OUTPUTS: $mode"
+        failed=1
+    fi
+    for outPath in "$work"/default/*.vm; do
+        if ! cmp -s "$outPath" "$work/$mode/$(basename "$outPath")"; then
+            echo "DIFFERENT: $mode $(basename "$outPath")"
+            diff "$outPath" "$work/$mode/$(basename "$outPath")" | head -n 10
+            failed=1
+        fi
+    done
+done
+
+if [ "$failed" -eq 0 ]; then
+    echo "check: $numOutputs outputs, the same in every mode"
+fi
+exit "$failed"
@@ -0,0 +1,125 @@
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+#include "AllocCounter.h"
+
+namespace
+{
+
+std::atomic<bool> counting = false;
+std::atomic<size_t> numAllocs = 0;
+std::atomic<size_t> numBytes = 0;
+
+}
+
+void startCountingAllocs()
+{
+    counting.store(true, std::memory_order_relaxed);
+}
+
+void stopCountingAllocs()
+{
+    counting.store(false, std::memory_order_relaxed);
+}
+
+AllocCount getAllocCount()
+{
+    AllocCount count;
+    count.allocs = numAllocs.load(std::memory_order_relaxed);
+    count.bytes = numBytes.load(std::memory_order_relaxed);
+    return count;
+}
+
+namespace
+{
+
+void *countedAlloc(std::size_t size)
+{
+    if (counting.load(std::memory_order_relaxed))
+    {
+        numAllocs.fetch_add(1, std::memory_order_relaxed);
+        numBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    if (size == 0)
+        size = 1;
+    while (true)
+    {
+        if (void *ptr = std::malloc(size))
+            return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == NULL)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+}
+
+// Every form allocates with malloc and frees with free, the pairs
+// have to match. The over-aligned forms (align_val_t) are left to
+// the library as a pair of their own and aren't counted.
+void *operator new(std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return countedAlloc(size);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return NULL;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return countedAlloc(size);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return NULL;
+    }
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
@@ -0,0 +1,241 @@
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstdio>
+
+#include "BatchBuild.h"
+#include "FileDiscovery.h"
+#include "Generator.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+void appendLines(const std::string &text, std::vector<std::string> &lines)
+{
+    std::istringstream textStrm(text);
+    std::string line;
+    while (std::getline(textStrm, line))
+    {
+        lines.push_back(line);
+    }
+}
+
+void writeJsonString(const std::string &str, std::ostream &strm)
+{
+    strm << '"';
+    for (const char c : str)
+    {
+        if (c == '"' || c == '\\')
+            strm << '\\' << c;
+        else if (c == '\n')
+            strm << "\\n";
+        else if (c == '\t')
+            strm << "\\t";
+        else if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)c);
+            strm << escaped;
+        }
+        else
+            strm << c;
+    }
+    strm << '"';
+}
+
+}
+
+bool loadManifest(const std::string &filePath, std::vector<BatchProject> &projects,
+    std::ostream &err)
+{
+    std::ifstream manifest(filePath);
+    if (!manifest)
+    {
+        err << "Can't read the manifest " << filePath << '\n';
+        return false;
+    }
+
+    const fs::path baseDir = fs::path(filePath).parent_path();
+    std::string line;
+    for (size_t lineNum = 1; std::getline(manifest, line); ++lineNum)
+    {
+        std::istringstream lineStrm(line);
+        std::string srcPath, outDir, extra;
+        if (!(lineStrm >> srcPath) || srcPath[0] == '#')
+            continue;
+        if (!(lineStrm >> outDir) || (lineStrm >> extra && extra[0] != '#'))
+        {
+            err << filePath << ':' << lineNum << ": expected <source path> <output directory>\n";
+            return false;
+        }
+
+        BatchProject &project = projects.emplace_back();
+        project.srcPath = (baseDir / srcPath).lexically_normal().string();
+        project.outDir = (baseDir / outDir).lexically_normal().string();
+    }
+    return true;
+}
+
+BatchBuild::BatchBuild(const CompilerOptions &options, const DiscoveryOptions &discovery,
+    ThreadPool &pool) : options(options), discovery(discovery), pool(pool)
+{}
+
+bool BatchBuild::loadLibs(const std::vector<std::string> &libsPaths, std::ostream &err)
+{
+    std::vector<std::string> filePaths;
+    if (!discoverFiles(libsPaths, discovery, pool, filePaths, NULL, err))
+        return false;
+
+    libUnits = std::vector<SourceUnit>(filePaths.size());
+    for (size_t i = 0; i < libUnits.size(); ++i)
+    {
+        libUnits[i].filePath = filePaths[i];
+    }
+
+    // the code is kept, written for every project
+    libsContext = std::make_unique<CompilerContext>(options);
+    BatchIO io(pool, options.ioUring);
+    lexUnits(pool, libUnits, options.limits, false, NULL, &io);
+    parseSignatures(*libsContext, pool, libUnits);
+    generateUnits(*libsContext, pool, libUnits, true, NULL);
+
+    for (const auto &unit : libUnits)
+    {
+        err << unit.diagnostics.str();
+    }
+    return unitsSucceeded(libUnits);
+}
+
+bool BatchBuild::libsUnchanged(const std::vector<std::string> &libsPaths) const
+{
+    std::ostringstream err;
+    std::vector<std::string> filePaths;
+    if (!discoverFiles(libsPaths, discovery, pool, filePaths, NULL, err) ||
+        filePaths.size() != libUnits.size())
+        return false;
+
+    for (size_t i = 0; i < filePaths.size(); ++i)
+    {
+        FileStamp stamp;
+        if (filePaths[i] != libUnits[i].filePath || !FileStamp::read(filePaths[i], stamp) ||
+            !(stamp == libUnits[i].stamp))
+            return false;
+    }
+    return true;
+}
+
+bool BatchBuild::writeLibs(const std::string &outDir, BatchIO &io, std::ostream &err) const
+{
+    std::vector<FileWrite> writes;
+    for (const auto &unit : libUnits)
+    {
+        const std::string outFileName = unit.name + "." + outFileExt;
+        writes.push_back({(fs::path(outDir) / outFileName).string(), &unit.vmCode});
+    }
+    io.writeFiles(writes);
+
+    bool written = true;
+    for (const auto &write : writes)
+    {
+        if (write.done)
+            continue;
+        err << "ERR: CAN'T WRITE " << write.path << '\n';
+        written = false;
+    }
+    return written;
+}
+
+void BatchBuild::buildProject(BatchProject &project)
+{
+    std::error_code ec;
+    fs::create_directories(project.outDir, ec);
+    if (ec)
+    {
+        project.diagnostics.push_back("Can't create the directory " + project.outDir);
+        return;
+    }
+
+    std::ostringstream err;
+    std::vector<std::string> filePaths;
+    if (!discoverFiles({project.srcPath}, discovery, pool, filePaths, NULL, err))
+    {
+        appendLines(err.str(), project.diagnostics);
+        return;
+    }
+
+    std::vector<SourceUnit> units(filePaths.size());
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        units[i].filePath = filePaths[i];
+    }
+
+    CompilerOptions projectOptions = options;
+    projectOptions.outDir = project.outDir;
+    CompilerContext context(*libsContext, projectOptions);
+
+    BatchIO io(pool, options.ioUring);
+    lexUnits(pool, units, options.limits, false, NULL, &io);
+    parseSignatures(context, pool, units);
+    generateUnits(context, pool, units, false, &io);
+    project.success = unitsSucceeded(units);
+    project.numFiles = units.size();
+
+    std::ostringstream writeErr;
+    const bool libsWritten = writeLibs(project.outDir, io, writeErr);
+
+    for (const auto &unit : units)
+    {
+        // the lexer has nothing to say about a file it didn't get
+        if (!unit.lexed && unit.diagnostics.str().empty())
+            project.diagnostics.push_back("ERR: CAN'T READ " + unit.filePath);
+        appendLines(unit.diagnostics.str(), project.diagnostics);
+    }
+    appendLines(writeErr.str(), project.diagnostics);
+    project.success = project.success && libsWritten;
+}
+
+bool BatchBuild::build(std::vector<BatchProject> &projects)
+{
+    // every project's stages run on the pool too,
+    // the threads a small project leaves idle help the others
+    pool.parallelFor(projects.size(), [&](size_t projectIdx)
+    {
+        buildProject(projects[projectIdx]);
+    });
+
+    for (const auto &project : projects)
+    {
+        if (!project.success)
+            return false;
+    }
+    return true;
+}
+
+void BatchBuild::writeSummary(const std::vector<BatchProject> &projects, std::ostream &strm)
+{
+    size_t numSucceeded = 0;
+    strm << "{\n  \"projects\": [";
+    for (size_t projectIdx = 0; projectIdx < projects.size(); ++projectIdx)
+    {
+        const BatchProject &project = projects[projectIdx];
+        if (project.success)
+            ++numSucceeded;
+
+        strm << (projectIdx == 0 ? "\n" : ",\n") << "    {\"src\": ";
+        writeJsonString(project.srcPath, strm);
+        strm << ", \"out\": ";
+        writeJsonString(project.outDir, strm);
+        strm << ", \"success\": " << (project.success ? "true" : "false")
+            << ", \"files\": " << project.numFiles << ", \"diagnostics\": [";
+        for (size_t diagIdx = 0; diagIdx < project.diagnostics.size(); ++diagIdx)
+        {
+            strm << (diagIdx == 0 ? "" : ", ");
+            writeJsonString(project.diagnostics[diagIdx], strm);
+        }
+        strm << "]}";
+    }
+    strm << "\n  ],\n  \"succeeded\": " << numSucceeded
+        << ",\n  \"failed\": " << projects.size() - numSucceeded << "\n}\n";
+}
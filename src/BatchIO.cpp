@@ -0,0 +1,485 @@
+#include <cstring>
+#include <functional>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "BatchIO.h"
+
+// Just enough of io_uring for batches of file operations, on the raw
+// syscalls. At most as many operations as the ring has entries are in
+// flight, the rest wait for their turn.
+class IoUring
+{
+private:
+    int ringFd = -1;
+    unsigned int numEntries = 0;
+
+    void *sqRingPtr = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void *cqRingPtr = MAP_FAILED;
+    size_t cqRingSize = 0;
+    io_uring_sqe *sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqesSize = 0;
+
+    unsigned int *sqTail = NULL;
+    unsigned int *sqMask = NULL;
+    unsigned int *sqArray = NULL;
+    unsigned int *cqHead = NULL;
+    unsigned int *cqTail = NULL;
+    unsigned int *cqMask = NULL;
+    io_uring_cqe *cqes = NULL;
+
+    bool supportsOps(std::initializer_list<unsigned int> opCodes);
+
+public:
+    ~IoUring();
+
+    // false if io_uring (or an operation used) isn't available
+    bool init(unsigned int entries);
+
+    // prepare fills the entry of operation idx, complete gets its result
+    // and returns false to have it submitted again (short reads/writes),
+    // false if the ring failed
+    bool run(size_t numOps, const std::function<void(size_t, io_uring_sqe&)> &prepare,
+        const std::function<bool(size_t, int)> &complete);
+};
+
+IoUring::~IoUring()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqesSize);
+    if (cqRingPtr != MAP_FAILED && cqRingPtr != sqRingPtr)
+        munmap(cqRingPtr, cqRingSize);
+    if (sqRingPtr != MAP_FAILED)
+        munmap(sqRingPtr, sqRingSize);
+    if (ringFd >= 0)
+        close(ringFd);
+}
+
+bool IoUring::supportsOps(std::initializer_list<unsigned int> opCodes)
+{
+    const size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    std::vector<char> probeMem(probeSize, 0);
+    auto *probe = reinterpret_cast<io_uring_probe*>(probeMem.data());
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, 256) < 0)
+        return false;
+
+    for (auto opCode : opCodes)
+    {
+        if (opCode > probe->last_op || !(probe->ops[opCode].flags & IO_URING_OP_SUPPORTED))
+            return false;
+    }
+    return true;
+}
+
+bool IoUring::init(unsigned int entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ringFd < 0)
+        return false;
+
+    if (!supportsOps({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE}))
+        return false;
+
+    numEntries = params.sq_entries;
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+    sqRingPtr = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ringFd, IORING_OFF_SQ_RING);
+    if (sqRingPtr == MAP_FAILED)
+        return false;
+
+    cqRingPtr = singleMmap ? sqRingPtr : mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (cqRingPtr == MAP_FAILED)
+        return false;
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe*)mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ringFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+
+    char *sqRing = static_cast<char*>(sqRingPtr);
+    sqTail = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.array);
+
+    char *cqRing = static_cast<char*>(cqRingPtr);
+    cqHead = reinterpret_cast<unsigned int*>(cqRing + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned int*>(cqRing + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned int*>(cqRing + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+    return true;
+}
+
+bool IoUring::run(size_t numOps, const std::function<void(size_t, io_uring_sqe&)> &prepare,
+    const std::function<bool(size_t, int)> &complete)
+{
+    std::vector<size_t> pendingOps(numOps);
+    for (size_t i = 0; i < numOps; ++i)
+    {
+        pendingOps[numOps - 1 - i] = i;
+    }
+
+    unsigned int inFlight = 0;
+    // in the ring, but not taken by the kernel yet
+    unsigned int queued = 0;
+    while (!pendingOps.empty() || inFlight > 0 || queued > 0)
+    {
+        // only this thread uses the ring, the new
+        // entries go after the ones still queued
+        unsigned int tail = *sqTail;
+        while (!pendingOps.empty() && inFlight + queued < numEntries)
+        {
+            const unsigned int sqIdx = tail & *sqMask;
+            io_uring_sqe &sqe = sqes[sqIdx];
+            memset(&sqe, 0, sizeof(sqe));
+            prepare(pendingOps.back(), sqe);
+            sqe.user_data = pendingOps.back();
+            sqArray[sqIdx] = sqIdx;
+            pendingOps.pop_back();
+            ++tail;
+            ++queued;
+        }
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+        long res = 0;
+        do
+        {
+            res = syscall(__NR_io_uring_enter, ringFd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        } while (res < 0 && errno == EINTR);
+        // the kernel can take fewer entries than given, the
+        // rest are given again next time, nothing to wait for
+        // with all of them left means it takes none
+        if (res < 0 || (res == 0 && queued > 0 && inFlight == 0))
+            return false;
+        inFlight += res;
+        queued -= res;
+
+        unsigned int head = *cqHead;
+        const unsigned int cqTailNow = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != cqTailNow; ++head)
+        {
+            const io_uring_cqe &cqe = cqes[head & *cqMask];
+            --inFlight;
+            if (!complete(cqe.user_data, cqe.res))
+                pendingOps.push_back(cqe.user_data);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+namespace
+{
+
+// more than this many files take more rounds, not a bigger ring
+constexpr unsigned int maxRingEntries = 256;
+
+bool readFileDirect(const std::string &path, std::string &data)
+{
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat;
+    bool success = fstat(fd, &fileStat) == 0;
+    if (success)
+        data.resize(fileStat.st_size);
+
+    size_t numRead = 0;
+    while (success && numRead < data.size())
+    {
+        const ssize_t res = pread(fd, data.data() + numRead, data.size() - numRead, numRead);
+        if (res < 0 && errno == EINTR)
+            continue;
+        if (res <= 0)
+        {
+            // shrunk in the meantime
+            success = res == 0;
+            data.resize(numRead);
+            break;
+        }
+        numRead += res;
+    }
+    close(fd);
+    return success;
+}
+
+bool writeFileDirect(const std::string &path, const std::string &data)
+{
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    size_t written = 0;
+    bool success = true;
+    while (written < data.size())
+    {
+        const ssize_t res = pwrite(fd, data.data() + written, data.size() - written, written);
+        if (res < 0 && errno == EINTR)
+            continue;
+        if (res <= 0)
+        {
+            success = false;
+            break;
+        }
+        written += res;
+    }
+    return close(fd) == 0 && success;
+}
+
+}
+
+BatchIO::BatchIO(ThreadPool &pool, bool useIoUring) : pool(pool)
+{
+    if (!useIoUring)
+        return;
+
+    ring = std::make_unique<IoUring>();
+    if (!ring->init(maxRingEntries))
+        ring.reset();
+}
+
+BatchIO::~BatchIO() = default;
+
+bool BatchIO::readFilesRing(std::vector<FileRead> &reads)
+{
+    const size_t numFiles = reads.size();
+    std::vector<int> fds(numFiles, -1);
+    std::vector<struct statx> stats(numFiles);
+    std::vector<bool> sized(numFiles, false);
+    std::vector<size_t> numRead(numFiles, 0);
+
+    bool ringOk = ring->run(numFiles,
+        [&](size_t i, io_uring_sqe &sqe)
+        {
+            sqe.opcode = IORING_OP_OPENAT;
+            sqe.fd = AT_FDCWD;
+            sqe.addr = (uint64_t)reads[i].path->c_str();
+            sqe.open_flags = O_RDONLY | O_CLOEXEC;
+        },
+        [&](size_t i, int res)
+        {
+            fds[i] = res;
+            return true;
+        });
+
+    ringOk = ringOk && ring->run(numFiles,
+        [&](size_t i, io_uring_sqe &sqe)
+        {
+            // the entries of files failed before are only
+            // placeholders, a bare NOP (its flags share fields
+            // with the other operations' arguments)
+            sqe.opcode = IORING_OP_NOP;
+            if (fds[i] < 0)
+                return;
+
+            sqe.opcode = IORING_OP_STATX;
+            sqe.fd = fds[i];
+            sqe.addr = (uint64_t)"";
+            sqe.len = STATX_SIZE;
+            sqe.statx_flags = AT_EMPTY_PATH;
+            sqe.off = (uint64_t)&stats[i];
+        },
+        [&](size_t i, int res)
+        {
+            sized[i] = fds[i] >= 0 && res == 0;
+            if (sized[i])
+                reads[i].data->resize(stats[i].stx_size);
+            // empty files are read already
+            reads[i].done = sized[i] && reads[i].data->empty();
+            return true;
+        });
+
+    ringOk = ringOk && ring->run(numFiles,
+        [&](size_t i, io_uring_sqe &sqe)
+        {
+            std::string &data = *reads[i].data;
+            sqe.opcode = IORING_OP_NOP;
+            if (!sized[i] || numRead[i] == data.size())
+                return;
+
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = fds[i];
+            sqe.addr = (uint64_t)(data.data() + numRead[i]);
+            sqe.len = data.size() - numRead[i];
+            sqe.off = numRead[i];
+        },
+        [&](size_t i, int res)
+        {
+            std::string &data = *reads[i].data;
+            if (!sized[i] || numRead[i] == data.size())
+                return true;
+            if (res <= 0)
+            {
+                // shrunk in the meantime
+                reads[i].done = res == 0;
+                data.resize(numRead[i]);
+                return true;
+            }
+            numRead[i] += res;
+            reads[i].done = numRead[i] == data.size();
+            return reads[i].done;
+        });
+
+    ringOk = ringOk && ring->run(numFiles,
+        [&](size_t i, io_uring_sqe &sqe)
+        {
+            sqe.opcode = IORING_OP_NOP;
+            if (fds[i] < 0)
+                return;
+
+            sqe.opcode = IORING_OP_CLOSE;
+            sqe.fd = fds[i];
+        },
+        [&](size_t i, int)
+        {
+            // the descriptor is released even if closing fails,
+            // and a file only read loses nothing then
+            fds[i] = -1;
+            return true;
+        });
+
+    if (!ringOk)
+    {
+        for (size_t i = 0; i < numFiles; ++i)
+        {
+            if (fds[i] >= 0)
+                close(fds[i]);
+        }
+    }
+    return ringOk;
+}
+
+bool BatchIO::writeFilesRing(std::vector<FileWrite> &writes)
+{
+    const size_t numFiles = writes.size();
+    std::vector<int> fds(numFiles, -1);
+    std::vector<size_t> written(numFiles, 0);
+    std::vector<bool> failed(numFiles, false);
+
+    bool ringOk = ring->run(numFiles,
+        [&](size_t i, io_uring_sqe &sqe)
+        {
+            sqe.opcode = IORING_OP_OPENAT;
+            sqe.fd = AT_FDCWD;
+            sqe.addr = (uint64_t)writes[i].path.c_str();
+            sqe.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+            sqe.len = 0644;
+        },
+        [&](size_t i, int res)
+        {
+            fds[i] = res;
+            return true;
+        });
+
+    ringOk = ringOk && ring->run(numFiles,
+        [&](size_t i, io_uring_sqe &sqe)
+        {
+            const std::string &data = *writes[i].data;
+            sqe.opcode = IORING_OP_NOP;
+            if (fds[i] < 0 || failed[i] || written[i] == data.size())
+                return;
+
+            sqe.opcode = IORING_OP_WRITE;
+            sqe.fd = fds[i];
+            sqe.addr = (uint64_t)(data.data() + written[i]);
+            sqe.len = data.size() - written[i];
+            sqe.off = written[i];
+        },
+        [&](size_t i, int res)
+        {
+            const std::string &data = *writes[i].data;
+            if (fds[i] < 0 || written[i] == data.size())
+                return true;
+            if (res <= 0)
+            {
+                failed[i] = true;
+                return true;
+            }
+            written[i] += res;
+            return written[i] == data.size();
+        });
+
+    ringOk = ringOk && ring->run(numFiles,
+        [&](size_t i, io_uring_sqe &sqe)
+        {
+            sqe.opcode = IORING_OP_NOP;
+            if (fds[i] < 0)
+                return;
+
+            sqe.opcode = IORING_OP_CLOSE;
+            sqe.fd = fds[i];
+        },
+        [&](size_t i, int res)
+        {
+            writes[i].done = fds[i] >= 0 && !failed[i] && res == 0 &&
+                written[i] == writes[i].data->size();
+            fds[i] = -1;
+            return true;
+        });
+
+    if (!ringOk)
+    {
+        for (size_t i = 0; i < numFiles; ++i)
+        {
+            if (fds[i] >= 0)
+                close(fds[i]);
+        }
+    }
+    return ringOk;
+}
+
+void BatchIO::readFiles(std::vector<FileRead> &reads)
+{
+    if (reads.empty())
+        return;
+    const bool processCpu = true;
+    const StageTimer timer(processCpu);
+    // whatever the ring didn't get to is read directly, a ring that
+    // failed is dropped (entries it didn't take can still be queued)
+    if (ring != nullptr && !readFilesRing(reads))
+        ring.reset();
+    if (ring == nullptr)
+    {
+        pool.parallelFor(reads.size(), [&reads](size_t i)
+        {
+            if (!reads[i].done)
+                reads[i].done = readFileDirect(*reads[i].path, *reads[i].data);
+        });
+    }
+    readTime += timer.elapsed();
+}
+
+void BatchIO::writeFiles(std::vector<FileWrite> &writes)
+{
+    if (writes.empty())
+        return;
+    const bool processCpu = true;
+    const StageTimer timer(processCpu);
+    if (ring != nullptr && !writeFilesRing(writes))
+        ring.reset();
+    if (ring == nullptr)
+    {
+        pool.parallelFor(writes.size(), [&writes](size_t i)
+        {
+            if (!writes[i].done)
+                writes[i].done = writeFileDirect(writes[i].path, *writes[i].data);
+        });
+    }
+    writeTime += timer.elapsed();
+}
@@ -0,0 +1,188 @@
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "BuildRecords.h"
+#include "Generator.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// changes whenever the records' format changes
+const char *recordsVersion = "jackdeps 2";
+
+}
+
+// the Makefile passes a checksum of the compiler's sources, so that
+// an upgraded compiler generates every file again
+#ifndef JACKC_SOURCES_SUM
+#define JACKC_SOURCES_SUM 0
+#endif
+#define JACKC_STR(x) JACKC_STR_(x)
+#define JACKC_STR_(x) #x
+
+BuildRecords::BuildRecords(const CompilerOptions &options)
+{
+    header = std::string(recordsVersion) + ' ' + JACKC_STR(JACKC_SOURCES_SUM) +
+        (options.directEmit ? " direct" : " tree");
+}
+
+std::string BuildRecords::recordsPath(const std::string &outDir)
+{
+    return (fs::path(outDir) / fileName).string();
+}
+
+// One line per entry, tab separated:
+//   file <source path> <modification time> <size>
+//   dep <Class.function> <signature>
+// where deps belong to the file above them
+bool BuildRecords::load(const std::string &filePath)
+{
+    records.clear();
+    std::ifstream recordsFile(filePath);
+    std::string line;
+    if (!std::getline(recordsFile, line) || line != header)
+        return false;
+
+    UnitRecord *curRecord = NULL;
+    while (std::getline(recordsFile, line))
+    {
+        std::istringstream lineStrm(line);
+        std::string kind, key, value;
+        std::getline(lineStrm, kind, '\t');
+        std::getline(lineStrm, key, '\t');
+        std::getline(lineStrm, value);
+
+        if (kind == "file")
+        {
+            std::istringstream stampStrm(value);
+            long long modTime = 0;
+            UnitRecord record;
+            if (!(stampStrm >> modTime >> record.stamp.size))
+            {
+                records.clear();
+                return false;
+            }
+            record.stamp.modTime = fs::file_time_type(fs::file_time_type::duration(modTime));
+            curRecord = &(records[key] = std::move(record));
+        }
+        else if (kind == "dep" && curRecord != NULL)
+        {
+            curRecord->funcDeps[key] = value;
+        }
+        else
+        {
+            records.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BuildRecords::save(const std::string &filePath) const
+{
+    // replaced in one step, a build that is stopped
+    // (or reading it concurrently) sees the old or the new,
+    // builds saving concurrently each write their own file
+    std::string tmpPath = filePath + ".XXXXXX";
+    const int tmpFd = mkstemp(tmpPath.data());
+    if (tmpFd < 0)
+        return false;
+    // mkstemp's are private to the owner
+    fchmod(tmpFd, 0644);
+    close(tmpFd);
+    {
+        std::ofstream recordsFile(tmpPath, std::ios::trunc);
+        recordsFile << header << '\n';
+        for (const auto &[srcPath, record] : records)
+        {
+            recordsFile << "file\t" << srcPath << '\t'
+                << (long long)record.stamp.modTime.time_since_epoch().count() << ' '
+                << record.stamp.size << '\n';
+            for (const auto &[funcName, sig] : record.funcDeps)
+            {
+                recordsFile << "dep\t" << funcName << '\t' << sig << '\n';
+            }
+        }
+        if (!recordsFile)
+        {
+            unlink(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, filePath, ec);
+    if (ec)
+        unlink(tmpPath.c_str());
+    return !ec;
+}
+
+size_t BuildRecords::markOutOfDate(CompilerContext &context, std::vector<SourceUnit> &units,
+    const std::string &outDir) const
+{
+    // the signature of "Class.function" in this build
+    auto curSignature = [&context](const std::string &funcName)
+    {
+        const size_t dotPos = funcName.find('.');
+        unsigned int classNameID = 0, funcNameID = 0;
+        if (dotPos == std::string::npos ||
+            !context.findIdentifier(funcName.substr(0, dotPos), classNameID) ||
+            !context.findIdentifier(funcName.substr(dotPos + 1), funcNameID))
+        {
+            return std::string();
+        }
+        return context.getFuncSignature(classNameID, funcNameID);
+    };
+
+    size_t numOutOfDate = 0;
+    for (auto &unit : units)
+    {
+        auto recordIt = records.find(unit.filePath);
+        std::error_code ec;
+        unit.generate = recordIt == records.end() || !(recordIt->second.stamp == unit.stamp) ||
+            !fs::exists(fs::path(outDir) / (unit.name + "." + outFileExt), ec);
+
+        if (!unit.generate)
+        {
+            for (const auto &[funcName, sig] : recordIt->second.funcDeps)
+            {
+                if (curSignature(funcName) != sig)
+                {
+                    unit.generate = true;
+                    break;
+                }
+            }
+        }
+        numOutOfDate += unit.generate;
+    }
+    return numOutOfDate;
+}
+
+void BuildRecords::update(const std::vector<SourceUnit> &units)
+{
+    std::unordered_map<std::string, UnitRecord> newRecords;
+    for (const auto &unit : units)
+    {
+        if (!unit.lexed)
+            continue;
+
+        if (!unit.generate)
+        {
+            auto recordIt = records.find(unit.filePath);
+            if (recordIt != records.end())
+                newRecords.insert(*recordIt);
+            continue;
+        }
+
+        if (unit.parsed || unit.numTokens == 0)
+            newRecords[unit.filePath] = {unit.stamp, unit.funcDeps};
+    }
+    records = std::move(newRecords);
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+
+#include "ClassGraph.h"
+
+ClassGraph::ClassGraph(const std::vector<SourceUnit> &units)
+    : unitDeps(units.size()), unitCosts(units.size())
+{
+    // a class defined twice belongs to the first unit, as in the class table
+    std::unordered_map<unsigned int, size_t> unitByClassNameID;
+    for (size_t unitIdx = 0; unitIdx < units.size(); ++unitIdx)
+    {
+        for (unsigned int classNameID : units[unitIdx].classNameIDs)
+        {
+            unitByClassNameID.emplace(classNameID, unitIdx);
+        }
+    }
+
+    // any identifier with a class's name counts, whether it's
+    // a type, a call or something else named the same
+    for (size_t unitIdx = 0; unitIdx < units.size(); ++unitIdx)
+    {
+        const tokensVect &tokens = units[unitIdx].lexState.tokens;
+        unitCosts[unitIdx] = tokens.size();
+
+        auto &deps = unitDeps[unitIdx];
+        for (const auto &token : tokens)
+        {
+            if (token.tType != TokenTypes::tIDENTIFIER || !token.tVal.has_value())
+                continue;
+
+            auto unitIt = unitByClassNameID.find(token.tVal.value());
+            if (unitIt != unitByClassNameID.end() && unitIt->second != unitIdx)
+                deps.push_back(unitIt->second);
+        }
+        std::sort(deps.begin(), deps.end());
+        deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+    }
+
+    findComponents();
+    findWaves();
+}
+
+void ClassGraph::findComponents()
+{
+    // Tarjan's, without recursion: hundreds of units can refer
+    // to each other in one long chain
+    const size_t numUnits = unitDeps.size();
+    const size_t unvisited = SIZE_MAX;
+    std::vector<size_t> indices(numUnits, unvisited);
+    std::vector<size_t> lowLinks(numUnits, 0);
+    std::vector<bool> onStack(numUnits, false);
+    std::vector<size_t> stack;
+    // the unit and its next dependency to look at
+    std::vector<std::pair<size_t, size_t>> dfsStack;
+    size_t nextIndex = 0;
+
+    componentByUnit.assign(numUnits, 0);
+    auto visit = [&](size_t unitIdx)
+    {
+        indices[unitIdx] = lowLinks[unitIdx] = nextIndex++;
+        stack.push_back(unitIdx);
+        onStack[unitIdx] = true;
+        dfsStack.push_back({unitIdx, 0});
+    };
+
+    for (size_t startIdx = 0; startIdx < numUnits; ++startIdx)
+    {
+        if (indices[startIdx] != unvisited)
+            continue;
+
+        visit(startIdx);
+        while (!dfsStack.empty())
+        {
+            const size_t unitIdx = dfsStack.back().first;
+            size_t &depPos = dfsStack.back().second;
+            if (depPos < unitDeps[unitIdx].size())
+            {
+                const size_t depIdx = unitDeps[unitIdx][depPos++];
+                if (indices[depIdx] == unvisited)
+                    visit(depIdx);
+                else if (onStack[depIdx])
+                    lowLinks[unitIdx] = std::min(lowLinks[unitIdx], indices[depIdx]);
+                continue;
+            }
+
+            dfsStack.pop_back();
+            if (!dfsStack.empty())
+            {
+                const size_t parentIdx = dfsStack.back().first;
+                lowLinks[parentIdx] = std::min(lowLinks[parentIdx], lowLinks[unitIdx]);
+            }
+            if (lowLinks[unitIdx] != indices[unitIdx])
+                continue;
+
+            // the components come out after everything they refer to
+            std::vector<size_t> component;
+            size_t memberIdx = 0;
+            do
+            {
+                memberIdx = stack.back();
+                stack.pop_back();
+                onStack[memberIdx] = false;
+                componentByUnit[memberIdx] = components.size();
+                component.push_back(memberIdx);
+            } while (memberIdx != unitIdx);
+
+            std::sort(component.begin(), component.end());
+            components.push_back(std::move(component));
+        }
+    }
+}
+
+void ClassGraph::findWaves()
+{
+    componentWaves.assign(components.size(), 0);
+    // the cost of the most expensive chain ending in the component
+    // and the component before it on the chain
+    std::vector<size_t> pathCosts(components.size(), 0);
+    std::vector<size_t> pathPrevs(components.size(), SIZE_MAX);
+
+    size_t lastIdx = SIZE_MAX;
+    for (size_t compIdx = 0; compIdx < components.size(); ++compIdx)
+    {
+        size_t cost = 0;
+        for (size_t unitIdx : components[compIdx])
+        {
+            cost += unitCosts[unitIdx];
+            for (size_t depIdx : unitDeps[unitIdx])
+            {
+                const size_t depCompIdx = componentByUnit[depIdx];
+                if (depCompIdx == compIdx)
+                    continue;
+
+                componentWaves[compIdx] = std::max(componentWaves[compIdx], componentWaves[depCompIdx] + 1);
+                if (pathPrevs[compIdx] == SIZE_MAX || pathCosts[depCompIdx] > pathCosts[pathPrevs[compIdx]])
+                    pathPrevs[compIdx] = depCompIdx;
+            }
+        }
+        pathCosts[compIdx] = cost + (pathPrevs[compIdx] != SIZE_MAX ? pathCosts[pathPrevs[compIdx]] : 0);
+        numWaves = std::max(numWaves, componentWaves[compIdx] + 1);
+
+        if (lastIdx == SIZE_MAX || pathCosts[compIdx] > pathCosts[lastIdx])
+            lastIdx = compIdx;
+    }
+
+    for (size_t compIdx = lastIdx; compIdx != SIZE_MAX; compIdx = pathPrevs[compIdx])
+    {
+        criticalPath.push_back(compIdx);
+    }
+    std::reverse(criticalPath.begin(), criticalPath.end());
+    criticalPathCost = lastIdx != SIZE_MAX ? pathCosts[lastIdx] : 0;
+}
+
+std::vector<size_t> ClassGraph::scheduleOrder() const
+{
+    std::vector<size_t> order(unitDeps.size());
+    for (size_t unitIdx = 0; unitIdx < order.size(); ++unitIdx)
+    {
+        order[unitIdx] = unitIdx;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t lhsIdx, size_t rhsIdx)
+    {
+        if (getUnitWave(lhsIdx) != getUnitWave(rhsIdx))
+            return getUnitWave(lhsIdx) < getUnitWave(rhsIdx);
+        return unitCosts[lhsIdx] > unitCosts[rhsIdx];
+    });
+    return order;
+}
+
+void ClassGraph::report(const std::vector<SourceUnit> &units, std::ostream &strm) const
+{
+    size_t numCycles = 0;
+    for (const auto &component : components)
+    {
+        if (component.size() > 1)
+            ++numCycles;
+    }
+    strm << "Class graph: " << units.size() << " units, " << numWaves << " waves, "
+        << numCycles << " cycles\n";
+
+    const std::vector<size_t> order = scheduleOrder();
+    for (unsigned int wave = 0; wave < numWaves; ++wave)
+    {
+        strm << "Wave " << wave << ":";
+        for (size_t unitIdx : order)
+        {
+            if (getUnitWave(unitIdx) == wave)
+                strm << ' ' << units[unitIdx].name;
+        }
+        strm << '\n';
+    }
+
+    for (const auto &component : components)
+    {
+        if (component.size() < 2)
+            continue;
+
+        strm << "Cycle:";
+        for (size_t unitIdx : component)
+        {
+            strm << ' ' << units[unitIdx].name;
+        }
+        strm << '\n';
+    }
+
+    strm << "Critical path (" << criticalPathCost << " tokens):";
+    for (size_t pathIdx = 0; pathIdx < criticalPath.size(); ++pathIdx)
+    {
+        strm << (pathIdx == 0 ? " " : " -> ");
+        const auto &component = components[criticalPath[pathIdx]];
+        for (size_t memberIdx = 0; memberIdx < component.size(); ++memberIdx)
+        {
+            strm << (memberIdx == 0 ? "" : "+") << units[component[memberIdx]].name;
+        }
+    }
+    strm << '\n';
+}
@@ -0,0 +1,507 @@
+#include <memory>
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+
+#include "CompileDriver.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Generator.h"
+#include "ClassGraph.h"
+#include "SizeEstimates.h"
+#include "Trace.h"
+
+std::chrono::steady_clock::time_point unitDeadline(const SourceUnit &unit, const ResourceLimits &limits,
+    std::chrono::steady_clock::time_point start)
+{
+    if (limits.maxFileMs == 0)
+        return std::chrono::steady_clock::time_point::max();
+    return start + std::chrono::milliseconds(limits.maxFileMs) - unit.busyTime;
+}
+
+bool overFileSize(SourceUnit &unit, uintmax_t size, const ResourceLimits &limits)
+{
+    if (limits.maxFileSize == 0 || size <= limits.maxFileSize)
+        return false;
+    unit.diagnostics << "ERR: LIMIT: " << unit.filePath << " IS " << size <<
+        " BYTES, MORE THAN " << limits.maxFileSize << " (--max-file-size)\n";
+    return true;
+}
+
+namespace
+{
+
+std::unique_ptr<Parser> newParser(CompilerContext &context, SourceUnit &unit,
+    ParsePasses parsePass, std::ostream &logStrm, std::chrono::steady_clock::time_point deadline)
+{
+    auto parser = std::make_unique<Parser>(context);
+    parser->setParsePass(parsePass);
+    parser->setStreams(logStrm, unit.diagnostics);
+    parser->setLimits(unit.filePath, context.getOptions().limits.maxAstNodes, deadline);
+    return parser;
+}
+
+// lex(lexer) tokenizes the unit, what a limit
+// stopped it at is reported and dropped
+template<typename Lex>
+void lexUnit(SourceUnit &unit, Lexer &lexer, const ResourceLimits &limits, Lex lex)
+{
+    const size_t tokensReserved = estimateTokens(unit.text.size());
+    const size_t identsReserved = estimateIdentifiers(unit.text.size());
+    unit.lexState.tokens.reserve(tokensReserved);
+    unit.lexState.identifiers.reserve(identsReserved);
+
+    const TraceScope trace("lex", unit.filePath);
+    const StageTimer timer;
+    lexer.setLimits(limits, unitDeadline(unit, limits, timer.getWallStart()));
+    unit.lexed = lex(lexer);
+    const StageTime lexTime = timer.elapsed();
+    unit.busyTime += lexTime.wall;
+    unit.times[BuildStages::bsLEX] += lexTime;
+
+    unit.stats.sourceBytes = unit.text.size();
+    unit.stats.estimatesExceeded += (unit.lexState.tokens.size() > tokensReserved) +
+        (unit.lexState.identifiers.size() > identsReserved);
+    if (lexer.getLimitHit().empty())
+        return;
+
+    unit.diagnostics << "ERR: LIMIT: " << unit.filePath << ": " << lexer.getLimitHit() << '\n';
+    unit.lexState = LexerState();
+}
+
+void addStateVisits(SourceUnit &unit, const Parser &parser)
+{
+    for (size_t state = 0; state < numParseFsmStates; ++state)
+    {
+        unit.stateVisits[state] += parser.getStateVisits()[state];
+    }
+}
+
+double toMs(std::chrono::nanoseconds time)
+{
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+double perSecond(size_t count, std::chrono::nanoseconds time)
+{
+    const double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? count / seconds : 0;
+}
+
+// the units by the position they're scheduled at
+std::vector<size_t> scheduleOrder(const std::vector<SourceUnit> &units)
+{
+    std::vector<size_t> order(units.size());
+    for (size_t unitIdx = 0; unitIdx < units.size(); ++unitIdx)
+    {
+        order[units[unitIdx].schedulePos] = unitIdx;
+    }
+    return order;
+}
+
+}
+
+void lexUnits(ThreadPool &pool, std::vector<SourceUnit> &units, const ResourceLimits &limits,
+    bool inMemory, SourceCache *cache, BatchIO *io)
+{
+    if (inMemory)
+    {
+        const TraceScope stageTrace("stage", "lex");
+        pool.parallelFor(units.size(), [&](size_t unitIdx)
+        {
+            auto &unit = units[unitIdx];
+            if (overFileSize(unit, unit.text.size(), limits))
+                return;
+            // no echo of the lines
+            std::ostream nullStrm(nullptr);
+            Lexer fileLexer(nullStrm);
+            std::istringstream jackSrc(unit.text);
+            lexUnit(unit, fileLexer, limits, [&](Lexer &lexer)
+            {
+                return tokenize(jackSrc, lexer, unit.lexState);
+            });
+        });
+        return;
+    }
+
+    assert(io != NULL);
+    pool.parallelFor(units.size(), [&](size_t unitIdx)
+    {
+        auto &unit = units[unitIdx];
+        if (cache == NULL || !cache->fetch(unit, unit.stamp))
+            FileStamp::read(unit.filePath, unit.stamp);
+        else
+            unit.stats.sourceBytes = unit.stamp.size;
+    });
+
+    // the files not in the cache are read in one batch
+    std::vector<FileRead> reads;
+    std::vector<size_t> readUnitIdxs;
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        if (units[i].lexed || overFileSize(units[i], units[i].stamp.size, limits))
+            continue;
+        reads.push_back({&units[i].filePath, &units[i].text});
+        readUnitIdxs.push_back(i);
+    }
+    {
+        const TraceScope stageTrace("stage", "read");
+        io->readFiles(reads);
+    }
+
+    const TraceScope stageTrace("stage", "lex");
+    pool.parallelFor(reads.size(), [&](size_t readIdx)
+    {
+        if (!reads[readIdx].done)
+            return;
+
+        auto &unit = units[readUnitIdxs[readIdx]];
+        // grown since its stamp was taken
+        if (overFileSize(unit, unit.text.size(), limits))
+        {
+            std::string().swap(unit.text);
+            return;
+        }
+
+        Lexer fileLexer(unit.lexLog);
+        lexUnit(unit, fileLexer, limits, [&unit](Lexer &lexer)
+        {
+            return tokenize(unit.filePath, unit.text, lexer, unit.lexState);
+        });
+        unit.name = fileLexer.getCurFileName();
+        std::string().swap(unit.text);
+        // the stamp read before reading, a file changed
+        // in the meantime is lexed again next time
+        if (cache != NULL && unit.lexed)
+            cache->store(unit, unit.stamp);
+    });
+}
+
+void parseSignatures(CompilerContext &context, ThreadPool &pool, std::vector<SourceUnit> &units,
+    std::ostream *scheduleLog)
+{
+    size_t numIdents = 0;
+    for (const auto &unit : units)
+    {
+        numIdents += unit.lexState.identifiers.size();
+    }
+    context.reserveIdentifiers(numIdents);
+
+    for (auto &unit : units)
+    {
+        if (!unit.lexed)
+            continue;
+        unit.numTokens = unit.lexState.tokens.size();
+        unit.stats.tokens = unit.numTokens;
+        unit.stats.identifiers = unit.lexState.identifiers.size();
+        context.mergeIdentifiers(unit.lexState);
+    }
+
+#ifndef LEXER_ONLY
+    // classes defined by the files get their ids in file order,
+    // only the ones that are referred to but never defined
+    // are added while the files are parsed concurrently
+    for (auto &unit : units)
+    {
+        unit.classNameIDs = context.declareClasses(unit.lexState.tokens);
+    }
+
+    // The classes are all declared and the phases don't depend on the
+    // order of the units, so the waves need no barriers between them.
+    // Starting the referred to and the big units first keeps
+    // the costly ones from being the last to finish.
+    const ClassGraph graph(units);
+    const std::vector<size_t> order = graph.scheduleOrder();
+    for (size_t pos = 0; pos < order.size(); ++pos)
+    {
+        units[order[pos]].schedulePos = pos;
+    }
+    if (scheduleLog != NULL)
+        graph.report(units, *scheduleLog);
+
+    const identifierVect &identifiers = context.getIdentifiers();
+
+    // phase 1: what the files can refer to in each other
+    const TraceScope stageTrace("stage", "signatures");
+    pool.parallelFor(order.size(), [&](size_t pos)
+    {
+        auto &unit = units[order[pos]];
+        if (!unit.lexed || unit.numTokens == 0)
+            return;
+
+        std::ostream nullStrm(nullptr);
+        const TraceScope trace("signatures", unit.filePath);
+        const StageTimer timer;
+        auto parser = newParser(context, unit, ParsePasses::ppSIGNATURES, nullStrm,
+            unitDeadline(unit, context.getOptions().limits, timer.getWallStart()));
+        parser->buildAST(unit.lexState.tokens, identifiers, 0);
+        unit.overLimit = parser->getStoppedAtLimit();
+        const StageTime parseTime = timer.elapsed();
+        unit.busyTime += parseTime.wall;
+        unit.times[BuildStages::bsPARSE] += parseTime;
+        addStateVisits(unit, *parser);
+    });
+#endif
+}
+
+void generateUnits(CompilerContext &context, ThreadPool &pool,
+    std::vector<SourceUnit> &units, bool inMemory, BatchIO *io, FuncCodeCache *funcCache)
+{
+#ifndef LEXER_ONLY
+    const identifierVect &identifiers = context.getIdentifiers();
+    const std::vector<size_t> order = scheduleOrder(units);
+
+    // the up to date units are done with theirs
+    for (auto &unit : units)
+    {
+        if (!unit.generate || unit.overLimit)
+            unit.lexState.releaseTokens();
+    }
+
+    // phase 2: function bodies and code, every file on its own
+    const bool traced = getTracing();
+    if (traced)
+        traceBegin("stage", "bodies");
+    pool.parallelFor(order.size(), [&](size_t pos)
+    {
+        auto &unit = units[order[pos]];
+        if (!unit.generate || !unit.lexed || unit.numTokens == 0 || unit.overLimit)
+            return;
+
+        std::ostream nullStrm(nullptr);
+        const TraceScope trace("bodies", unit.filePath);
+        const StageTimer timer;
+        const auto deadline = unitDeadline(unit, context.getOptions().limits, timer.getWallStart());
+        auto parser = newParser(context, unit, ParsePasses::ppBODIES, inMemory ? nullStrm : unit.log, deadline);
+        Generator generator(unit.name, identifiers);
+        generator.setDeadline(deadline);
+        const size_t vmBytesReserved = estimateVmBytes(unit.numTokens);
+        generator.reserveOutput(vmBytesReserved);
+
+        if (context.getOptions().directEmit)
+        {
+            // the generator is fed while parsing, no AST to log,
+            // the code generation is timed as parsing
+            parser->setDirectEmission(&generator);
+            parser->buildAST(unit.lexState.tokens, identifiers, 0);
+            parser->setDirectEmission(NULL);
+            unit.times[BuildStages::bsPARSE] += timer.elapsed();
+            unit.lexState.releaseTokens();
+            unit.parsed = parser->getFinishedCorrectly();
+        }
+        else
+        {
+            // direct emission releases the nodes function by function
+            const size_t nodesReserved = estimateAstNodes(unit.numTokens);
+            parser->reserveAstNodes(nodesReserved);
+            if (funcCache != NULL)
+                parser->keepFuncKeys();
+            auto *astRoot = parser->buildAST(unit.lexState.tokens, identifiers, 0);
+            unit.times[BuildStages::bsPARSE] += timer.elapsed();
+            // the tree has everything of them
+            unit.lexState.releaseTokens();
+            unit.stats.estimatesExceeded += parser->getNumAstNodes() > nodesReserved;
+            unit.parsed = parser->getFinishedCorrectly();
+        #ifdef DEBUG
+            if (!inMemory)
+                parser->printAST(unit.log);
+        #endif
+            // nothing is generated for a unit over a limit,
+            // code around a syntax error still is
+            if (!parser->getStoppedAtLimit())
+            {
+                const TraceScope genTrace("codegen", unit.filePath);
+                const StageTimer genTimer;
+                generator.generate(astRoot, &pool, funcCache, &parser->getFuncKeys());
+                // the functions ran on the pool's threads, not only on this one
+                StageTime genTime = genTimer.elapsed();
+                genTime.cpu = generator.getCpuTime();
+                unit.times[BuildStages::bsCODEGEN] += genTime;
+            }
+        }
+        unit.busyTime += timer.elapsed().wall;
+        unit.stats.astNodes = parser->getNumAstNodes();
+        addStateVisits(unit, *parser);
+
+        // no output at all, the parser has reported its limit
+        if (parser->getStoppedAtLimit() || generator.getOutOfTime())
+        {
+            if (generator.getOutOfTime())
+                unit.diagnostics << "ERR: LIMIT: " << unit.filePath << ": OUT OF TIME GENERATING IT (--max-file-ms)\n";
+            unit.parsed = false;
+            return;
+        }
+
+        // calls into the unit's own classes don't depend on anything outside
+        for (const auto &[classNameID, funcNameID] : parser->getUsedFuncs())
+        {
+            const auto &ownClasses = unit.classNameIDs;
+            if (std::find(ownClasses.begin(), ownClasses.end(), classNameID) != ownClasses.end())
+                continue;
+
+            const std::string funcName = identifiers[classNameID] + '.' + identifiers[funcNameID];
+            unit.funcDeps[funcName] = context.getFuncSignature(classNameID, funcNameID);
+        }
+
+        const auto &output = generator.getOutput();
+        // one command a line, before the output's end is added
+        if (context.getOptions().timeReport)
+            unit.stats.vmInstructions = std::count(output.data(), output.data() + output.size(), '\n');
+        generator.finishOutput();
+        unit.stats.vmBytes = output.size();
+        unit.stats.estimatesExceeded += output.size() > vmBytesReserved;
+        unit.vmCode.assign(output.data(), output.size());
+        if (!inMemory)
+        {
+            generator.setOutDir(context.getOptions().outDir);
+            unit.outFilePath = generator.getOutFilePath();
+        }
+    });
+    if (traced)
+        traceEnd();
+
+    if (inMemory)
+        return;
+
+    // all outputs are written in one batch
+    assert(io != NULL);
+    std::vector<FileWrite> writes;
+    std::vector<size_t> writeUnitIdxs;
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        if (units[i].outFilePath.empty())
+            continue;
+        writes.push_back({units[i].outFilePath, &units[i].vmCode});
+        writeUnitIdxs.push_back(i);
+    }
+    {
+        const TraceScope stageTrace("stage", "write");
+        io->writeFiles(writes);
+    }
+
+    for (size_t i = 0; i < writes.size(); ++i)
+    {
+        auto &unit = units[writeUnitIdxs[i]];
+        if (!writes[i].done)
+            unit.diagnostics << "ERR: CAN'T WRITE " << unit.outFilePath << '\n';
+        std::string().swap(unit.vmCode);
+    }
+#endif
+}
+
+bool unitsSucceeded(const std::vector<SourceUnit> &units)
+{
+    bool success = true;
+    for (const auto &unit : units)
+    {
+    #ifndef LEXER_ONLY
+        if (unit.generate && !unit.parsed && unit.numTokens != 0)
+            success = false;
+    #endif
+        if (!unit.lexed)
+            success = false;
+    }
+    return success;
+}
+
+void printStats(const std::vector<SourceUnit> &units, std::ostream &out)
+{
+    UnitStats total;
+    size_t numUpToDate = 0;
+    for (const auto &unit : units)
+    {
+        numUpToDate += !unit.generate;
+        total.sourceBytes += unit.stats.sourceBytes;
+        total.tokens += unit.stats.tokens;
+        total.identifiers += unit.stats.identifiers;
+        total.astNodes += unit.stats.astNodes;
+        total.vmBytes += unit.stats.vmBytes;
+        total.estimatesExceeded += unit.stats.estimatesExceeded;
+    }
+
+    out << "files: " << units.size() << '\n';
+    // their AST nodes and code aren't counted
+    out << "up to date, not generated: " << numUpToDate << '\n';
+    out << "source bytes: " << total.sourceBytes << '\n';
+    out << "tokens: " << total.tokens << '\n';
+    out << "identifiers: " << total.identifiers << '\n';
+    out << "AST nodes: " << total.astNodes << '\n';
+    out << "VM bytes: " << total.vmBytes << '\n';
+    out << "estimates exceeded: " << total.estimatesExceeded << '\n';
+}
+
+void printTimeReport(const std::vector<SourceUnit> &units, const StageTimes &buildTimes,
+    const StageTime &total, std::ostream &out)
+{
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    const BuildStages unitStages[] = {BuildStages::bsLEX, BuildStages::bsPARSE, BuildStages::bsCODEGEN};
+    StageTimes stageTotals = buildTimes;
+    UnitStats statTotals;
+    StateVisits visitTotals{};
+    out << "time report, ms wall/cpu:\n";
+    for (const auto &unit : units)
+    {
+        out << unit.filePath << ':';
+        for (BuildStages stage : unitStages)
+        {
+            const StageTime &time = unit.times[stage];
+            out << ' ' << buildStageName(stage) << ' ' << toMs(time.wall) << '/' << toMs(time.cpu);
+            stageTotals[stage] += time;
+        }
+        // lexed and through phase 1 only
+        out << (unit.generate ? "\n" : " (up to date, not generated)\n");
+
+        statTotals.sourceBytes += unit.stats.sourceBytes;
+        statTotals.tokens += unit.stats.tokens;
+        statTotals.astNodes += unit.stats.astNodes;
+        statTotals.vmInstructions += unit.stats.vmInstructions;
+        for (size_t state = 0; state < numParseFsmStates; ++state)
+        {
+            visitTotals[state] += unit.stateVisits[state];
+        }
+    }
+
+    for (size_t stage = 0; stage < numBuildStages; ++stage)
+    {
+        const StageTime &time = stageTotals.stages[stage];
+        out << buildStageName((BuildStages)stage) << ": " << toMs(time.wall) << '/' << toMs(time.cpu) << '\n';
+    }
+    out << "total: " << toMs(total.wall) << '/' << toMs(total.cpu) << '\n';
+
+    // over the units' own time in the stage, --direct generates while parsing
+    const StageTime &lexTime = stageTotals[BuildStages::bsLEX];
+    const StageTime &parseTime = stageTotals[BuildStages::bsPARSE];
+    const StageTime &genTime = stageTotals[BuildStages::bsCODEGEN];
+    out << std::setprecision(0);
+    out << "throughput: " << perSecond(statTotals.sourceBytes, lexTime.wall) << " bytes/s, " <<
+        perSecond(statTotals.tokens, parseTime.wall) << " tokens/s, " <<
+        perSecond(statTotals.astNodes, parseTime.wall) << " nodes/s, " <<
+        perSecond(statTotals.vmInstructions, genTime.wall.count() > 0 ? genTime.wall : parseTime.wall) <<
+        " VM instructions/s\n";
+
+    out << "parser states:";
+    for (size_t state = 0; state < numParseFsmStates; ++state)
+    {
+        out << ' ' << parseFsmStateName((ParseFsmStates)state) << ' ' << visitTotals[state];
+    }
+    out << '\n';
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool compileUnits(CompilerContext &context, ThreadPool &pool,
+    std::vector<SourceUnit> &units, bool inMemory, SourceCache *cache)
+{
+    std::unique_ptr<BatchIO> io;
+    if (!inMemory)
+        io = std::make_unique<BatchIO>(pool, context.getOptions().ioUring);
+
+    lexUnits(pool, units, context.getOptions().limits, inMemory, cache, io.get());
+    parseSignatures(context, pool, units);
+    generateUnits(context, pool, units, inMemory, io.get());
+    return unitsSucceeded(units);
+}
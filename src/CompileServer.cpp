@@ -0,0 +1,300 @@
+#include <cstring>
+#include <cstdint>
+#include <csignal>
+#include <thread>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "CompileServer.h"
+
+namespace
+{
+
+// removed when the server is stopped
+char signalSocketPath[sizeof(sockaddr_un::sun_path)];
+
+// a request is a command line, bigger ones are refused
+// before anything is allocated for them
+const uint32_t maxRequestStrings = 4096;
+const uint32_t maxRequestStringSize = 64 * 1024;
+
+void onStopSignal(int)
+{
+    unlink(signalSocketPath);
+    _exit(0);
+}
+
+bool writeAll(int fd, const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool readAll(int fd, void *data, size_t size)
+{
+    char *bytes = static_cast<char*>(data);
+    while (size > 0)
+    {
+        const ssize_t numRead = read(fd, bytes, size);
+        if (numRead < 0 && errno == EINTR)
+            continue;
+        if (numRead <= 0)
+            return false;
+        bytes += numRead;
+        size -= numRead;
+    }
+    return true;
+}
+
+bool sendUint(int fd, uint32_t val)
+{
+    return writeAll(fd, &val, sizeof(val));
+}
+
+bool recvUint(int fd, uint32_t &val)
+{
+    return readAll(fd, &val, sizeof(val));
+}
+
+bool sendString(int fd, const std::string &str)
+{
+    return sendUint(fd, str.size()) && writeAll(fd, str.data(), str.size());
+}
+
+bool recvString(int fd, std::string &str, uint32_t maxSize)
+{
+    uint32_t size = 0;
+    if (!recvUint(fd, size) || size > maxSize)
+        return false;
+    str.resize(size);
+    return readAll(fd, str.data(), size);
+}
+
+bool sendFrame(int fd, char channel, const std::string &payload)
+{
+    return writeAll(fd, &channel, 1) && sendString(fd, payload);
+}
+
+// The outputs go to the client's working directory, so only the
+// server's own user is served and only in a directory of theirs.
+// What's refused is explained in reason.
+bool peerAllowed(int connFd, const std::string &workDir, std::string &reason)
+{
+    ucred cred{};
+    socklen_t credSize = sizeof(cred);
+    if (getsockopt(connFd, SOL_SOCKET, SO_PEERCRED, &cred, &credSize) != 0 || cred.uid != geteuid())
+    {
+        reason = "The compile server only serves the user running it\n";
+        return false;
+    }
+
+    struct stat dirStat{};
+    if (workDir.empty() || workDir[0] != '/' || stat(workDir.c_str(), &dirStat) != 0 ||
+        !S_ISDIR(dirStat.st_mode) || dirStat.st_uid != cred.uid)
+    {
+        reason = "Not a directory of the client's: " + workDir + '\n';
+        return false;
+    }
+    return true;
+}
+
+bool makeAddress(const std::string &socketPath, sockaddr_un &addr)
+{
+    if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path))
+        return false;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return true;
+}
+
+}
+
+CompileServer::CompileServer(const std::string &socketPath, serveRequestFunc handleRequest,
+    unsigned int maxConnections) : socketPath(socketPath), handleRequest(std::move(handleRequest)),
+    maxConnections(std::max(maxConnections, 1u))
+{}
+
+CompileServer::~CompileServer()
+{
+    if (listenFd >= 0)
+    {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+}
+
+bool CompileServer::run()
+{
+    sockaddr_un addr;
+    if (!makeAddress(socketPath, addr))
+    {
+        std::cerr << "Invalid socket path: " << socketPath << '\n';
+        return false;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        std::cerr << "Can't create the socket: " << strerror(errno) << '\n';
+        return false;
+    }
+
+    // a socket file left behind by a server that is gone is replaced,
+    // one that still accepts connections is not
+    if (connect(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+    {
+        std::cerr << "A server is already listening on " << socketPath << '\n';
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    unlink(socketPath.c_str());
+
+    // nobody else may connect, the mode is set before any connection
+    // can be accepted
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        chmod(socketPath.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0)
+    {
+        std::cerr << "Can't listen on " << socketPath << ": " << strerror(errno) << '\n';
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    memcpy(signalSocketPath, addr.sun_path, sizeof(signalSocketPath));
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    // clients that go away mid-response are not fatal
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Serving on " << socketPath << std::endl;
+    while (true)
+    {
+        // the clients over the limit wait in the listen backlog
+        {
+            std::unique_lock<std::mutex> lock(connectionsMutex);
+            connectionDone.wait(lock, [this]{ return numConnections < maxConnections; });
+        }
+
+        const int connFd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+        if (connFd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            std::cerr << "Accepting failed: " << strerror(errno) << '\n';
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            ++numConnections;
+        }
+        std::thread([this, connFd]
+        {
+            serveConnection(connFd);
+            close(connFd);
+
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            --numConnections;
+            connectionDone.notify_one();
+        }).detach();
+    }
+}
+
+void CompileServer::serveConnection(int connFd)
+{
+    uint32_t numStrings = 0;
+    std::string workDir;
+    std::vector<std::string> args;
+    bool received = recvUint(connFd, numStrings) && numStrings > 0 && numStrings <= maxRequestStrings &&
+        recvString(connFd, workDir, maxRequestStringSize);
+    for (uint32_t i = 1; received && i < numStrings; ++i)
+    {
+        args.emplace_back();
+        received = recvString(connFd, args.back(), maxRequestStringSize);
+    }
+    if (!received)
+        return;
+
+    std::ostringstream out, err;
+    std::string refused;
+    int exitCode = 1;
+    if (peerAllowed(connFd, workDir, refused))
+        exitCode = handleRequest(args, workDir, out, err);
+    else
+        err << refused;
+
+    sendFrame(connFd, 'o', out.str()) &&
+        sendFrame(connFd, 'e', err.str()) &&
+        writeAll(connFd, "x", 1) &&
+        sendUint(connFd, exitCode);
+}
+
+int runCompileClient(const std::string &socketPath, int argc, char *argv[])
+{
+    sockaddr_un addr;
+    if (!makeAddress(socketPath, addr))
+    {
+        std::cerr << "Invalid socket path: " << socketPath << '\n';
+        return 1;
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        std::cerr << "Can't connect to the compile server on " << socketPath << '\n';
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
+
+    bool sent = sendUint(fd, argc) && sendString(fd, std::filesystem::current_path().string());
+    for (int i = 1; sent && i < argc; ++i)
+    {
+        sent = sendString(fd, argv[i]);
+    }
+
+    char channel = 0;
+    std::string payload;
+    uint32_t exitCode = 1;
+    bool finished = false;
+    while (sent && readAll(fd, &channel, 1))
+    {
+        if (channel == 'x')
+        {
+            finished = recvUint(fd, exitCode);
+            break;
+        }
+        // the server's output, as big as the compilation's
+        if (!recvString(fd, payload, UINT32_MAX))
+            break;
+        (channel == 'e' ? std::cerr : std::cout) << payload;
+    }
+    close(fd);
+
+    if (!finished)
+    {
+        std::cerr << "Lost the connection to the compile server\n";
+        return 1;
+    }
+    return exitCode;
+}
@@ -0,0 +1,105 @@
+#include "CompilerContext.h"
+
+CompilerContext::CompilerContext(const CompilerOptions &options) : options(options)
+{
+    arrayLib_className_id = addIdentifier("Array");
+    thisNameID = addIdentifier("this");
+
+    // the Array system class always has the first id
+    classTable.findOrAdd(arrayLib_className_id);
+}
+
+CompilerContext::CompilerContext(const CompilerContext &base, const CompilerOptions &options)
+    : options(options), identifiers(base.identifiers), identIdxByName(base.identIdxByName),
+    classTable(base.classTable), arrayLib_className_id(base.arrayLib_className_id),
+    thisNameID(base.thisNameID)
+{}
+
+unsigned int CompilerContext::addIdentifier(const std::string &ident)
+{
+    auto [iter, inserted] = identIdxByName.try_emplace(ident, identifiers.size());
+    if (inserted)
+        identifiers.push_back(ident);
+    return iter->second;
+}
+
+bool CompilerContext::findIdentifier(const std::string &ident, unsigned int &identID) const
+{
+    auto iter = identIdxByName.find(ident);
+    if (iter == identIdxByName.end())
+        return false;
+    identID = iter->second;
+    return true;
+}
+
+void CompilerContext::reserveIdentifiers(size_t numMore)
+{
+    identifiers.reserve(identifiers.size() + numMore);
+    identIdxByName.reserve(identifiers.size() + numMore);
+}
+
+void CompilerContext::mergeIdentifiers(LexerState &lexState)
+{
+    std::vector<unsigned int> globalIDs(lexState.identifiers.size());
+    for (size_t i = 0; i < lexState.identifiers.size(); ++i)
+    {
+        globalIDs[i] = addIdentifier(lexState.identifiers[i]);
+    }
+
+    for (auto &token : lexState.tokens)
+    {
+        if (token.tType == TokenTypes::tIDENTIFIER)
+            token.tVal = globalIDs[token.tVal.value()];
+    }
+    lexState.identifiers.clear();
+}
+
+std::vector<unsigned int> CompilerContext::declareClasses(const tokensVect &tokens)
+{
+    std::vector<unsigned int> classNameIDs;
+    for (size_t i = 0; i + 1 < tokens.size(); ++i)
+    {
+        if (tokens[i].tType == TokenTypes::tCLASS &&
+            tokens[i + 1].tType == TokenTypes::tIDENTIFIER)
+        {
+            classTable.findOrAdd(tokens[i + 1].tVal.value());
+            classNameIDs.push_back(tokens[i + 1].tVal.value());
+        }
+    }
+    return classNameIDs;
+}
+
+void CompilerContext::appendFuncSignature(std::string &sig, const FunctionData &func)
+{
+    auto appendType = [this, &sig](LangDataTypes ldType)
+    {
+        if (ldType >= LangDataTypes::ldCLASS)
+            sig += identifiers[classTable.getByID(ldType_to_classID(ldType)).nameID];
+        else
+            sig += std::to_string((unsigned int)ldType);
+    };
+
+    sig += identifiers[func.nameID];
+    sig += func.isCtor ? " c " : (func.isMethod ? " m " : " f ");
+    appendType(func.ldType_ret);
+    for (const auto &arg : func.argVars)
+    {
+        sig += ' ';
+        appendType(arg.valueType);
+    }
+    sig += ';';
+}
+
+std::string CompilerContext::getFuncSignature(unsigned int classNameID, unsigned int funcNameID)
+{
+    std::string sig;
+    auto [classFound, classID] = classTable.find(classNameID);
+    if (!classFound)
+        return sig;
+
+    const ClassData &classData = classTable.getByID(classID);
+    auto [funcFound, funcIdx] = classData.containsFunc(funcNameID);
+    if (funcFound)
+        appendFuncSignature(sig, classData.getFuncs()[funcIdx]);
+    return sig;
+}
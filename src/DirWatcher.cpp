@@ -0,0 +1,92 @@
+#include <iostream>
+#include <cstring>
+#include <climits>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+#include "DirWatcher.h"
+
+DirWatcher::DirWatcher(const std::string &fileExt) : fileExt(fileExt)
+{
+    inotifyFd = inotify_init1(IN_CLOEXEC);
+    if (inotifyFd < 0)
+        std::cerr << "Can't start inotify: " << strerror(errno) << '\n';
+}
+
+DirWatcher::~DirWatcher()
+{
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+}
+
+bool DirWatcher::addDir(const std::string &dirPath)
+{
+    if (inotifyFd < 0)
+        return false;
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+        IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(inotifyFd, dirPath.c_str(), mask) < 0)
+    {
+        std::cerr << "Can't watch " << dirPath << ": " << strerror(errno) << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool DirWatcher::readEvents(bool &changed)
+{
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    ssize_t numRead = 0;
+    do
+    {
+        numRead = read(inotifyFd, buffer, sizeof(buffer));
+    } while (numRead < 0 && errno == EINTR);
+    if (numRead <= 0)
+        return false;
+
+    for (char *eventPtr = buffer; eventPtr < buffer + numRead; )
+    {
+        const auto *event = reinterpret_cast<const inotify_event*>(eventPtr);
+        eventPtr += sizeof(inotify_event) + event->len;
+
+        if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+        {
+            std::cerr << "A watched directory is gone\n";
+            return false;
+        }
+
+        const size_t nameLen = event->len > 0 ? strlen(event->name) : 0;
+        if (nameLen > fileExt.size() &&
+            fileExt.compare(0, fileExt.size(), event->name + nameLen - fileExt.size()) == 0)
+        {
+            changed = true;
+        }
+    }
+    return true;
+}
+
+bool DirWatcher::waitForChanges()
+{
+    if (inotifyFd < 0)
+        return false;
+
+    // the outputs written next to the sources don't count
+    bool changed = false;
+    while (!changed)
+    {
+        if (!readEvents(changed))
+            return false;
+    }
+
+    // an editor saving a file can take a few events
+    pollfd pollFd{inotifyFd, POLLIN, 0};
+    while (poll(&pollFd, 1, settleMs) > 0)
+    {
+        if (!readEvents(changed))
+            return false;
+    }
+    return true;
+}
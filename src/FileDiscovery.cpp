@@ -0,0 +1,181 @@
+#include <filesystem>
+#include <algorithm>
+#include <unordered_set>
+
+#include "FileDiscovery.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+struct DirToList
+{
+    std::string path;
+    // relative to its root, empty for the root
+    std::string relPath;
+    size_t rootIdx;
+};
+
+struct DirListing
+{
+    std::vector<DirToList> subdirs;
+    std::vector<std::string> filePaths;
+    bool listed = true;
+};
+
+bool matchGlobFrom(const std::string &glob, size_t globIdx, const std::string &path, size_t pathIdx)
+{
+    while (globIdx < glob.size())
+    {
+        const char globChar = glob[globIdx];
+        if (globChar == '*' && globIdx + 1 < glob.size() && glob[globIdx + 1] == '*')
+        {
+            globIdx += 2;
+            // "**/" is any number of directories, none too
+            const bool dirsOnly = globIdx < glob.size() && glob[globIdx] == '/';
+            if (dirsOnly)
+                ++globIdx;
+            for (size_t restIdx = pathIdx; restIdx <= path.size(); ++restIdx)
+            {
+                if (dirsOnly && restIdx != pathIdx && path[restIdx - 1] != '/')
+                    continue;
+                if (matchGlobFrom(glob, globIdx, path, restIdx))
+                    return true;
+            }
+            return false;
+        }
+        if (globChar == '*')
+        {
+            ++globIdx;
+            for (size_t restIdx = pathIdx; ; ++restIdx)
+            {
+                if (matchGlobFrom(glob, globIdx, path, restIdx))
+                    return true;
+                if (restIdx == path.size() || path[restIdx] == '/')
+                    return false;
+            }
+        }
+
+        if (pathIdx == path.size())
+            return false;
+        if (globChar == '?' ? path[pathIdx] == '/' : path[pathIdx] != globChar)
+            return false;
+        ++globIdx;
+        ++pathIdx;
+    }
+    return pathIdx == path.size();
+}
+
+bool matchesAny(const std::vector<std::string> &globs, const std::string &relPath)
+{
+    return std::any_of(globs.begin(), globs.end(), [&relPath](const std::string &glob)
+    {
+        return matchGlob(glob, relPath);
+    });
+}
+
+void listDir(const DirToList &dir, const DiscoveryOptions &options, DirListing &listing)
+{
+    std::error_code ec;
+    fs::directory_iterator dirIt(dir.path, ec);
+    for (; !ec && dirIt != fs::directory_iterator(); dirIt.increment(ec))
+    {
+        const fs::directory_entry &entry = *dirIt;
+        const std::string name = entry.path().filename().string();
+        const std::string relPath = dir.relPath.empty() ? name : dir.relPath + '/' + name;
+
+        std::error_code entryEc;
+        if (entry.is_directory(entryEc))
+        {
+            // symlinked directories aren't followed, they can loop
+            if (options.recursive && !entry.is_symlink(entryEc) && !matchesAny(options.excludes, relPath))
+                listing.subdirs.push_back({entry.path().string(), relPath, dir.rootIdx});
+            continue;
+        }
+
+        if (!isJackFile(name) || matchesAny(options.excludes, relPath))
+            continue;
+        if (options.includes.empty() || matchesAny(options.includes, relPath))
+            listing.filePaths.push_back(entry.path().string());
+    }
+    listing.listed = !ec;
+}
+
+}
+
+bool isJackFile(const std::string &path)
+{
+    return fs::path(path).extension() == ".jack";
+}
+
+bool matchGlob(const std::string &glob, const std::string &path)
+{
+    // a glob without directories is about the name only
+    if (glob.find('/') == std::string::npos)
+    {
+        const size_t nameIdx = path.find_last_of('/');
+        return matchGlobFrom(glob, 0, path, nameIdx == std::string::npos ? 0 : nameIdx + 1);
+    }
+    return matchGlobFrom(glob, 0, path, 0);
+}
+
+bool discoverFiles(const std::vector<std::string> &roots, const DiscoveryOptions &options,
+    ThreadPool &pool, std::vector<std::string> &filePaths,
+    std::vector<std::string> *dirPaths, std::ostream &err)
+{
+    bool success = true;
+    std::vector<std::vector<std::string>> rootFilePaths(roots.size());
+
+    // all the roots walked together, level by level, the
+    // directories of a level listed in parallel
+    std::vector<DirToList> level;
+    for (size_t rootIdx = 0; rootIdx < roots.size(); ++rootIdx)
+    {
+        std::error_code ec;
+        if (fs::is_directory(roots[rootIdx], ec))
+            level.push_back({roots[rootIdx], "", rootIdx});
+        else
+            rootFilePaths[rootIdx].push_back(roots[rootIdx]);
+    }
+
+    while (!level.empty())
+    {
+        std::vector<DirListing> listings(level.size());
+        pool.parallelFor(level.size(), [&](size_t dirIdx)
+        {
+            listDir(level[dirIdx], options, listings[dirIdx]);
+        });
+
+        std::vector<DirToList> nextLevel;
+        for (size_t dirIdx = 0; dirIdx < level.size(); ++dirIdx)
+        {
+            DirListing &listing = listings[dirIdx];
+            if (!listing.listed)
+            {
+                err << "Can't list the directory " << level[dirIdx].path << '\n';
+                success = false;
+            }
+            if (dirPaths != NULL)
+                dirPaths->push_back(level[dirIdx].path);
+
+            auto &toPaths = rootFilePaths[level[dirIdx].rootIdx];
+            toPaths.insert(toPaths.end(), listing.filePaths.begin(), listing.filePaths.end());
+            std::move(listing.subdirs.begin(), listing.subdirs.end(), std::back_inserter(nextLevel));
+        }
+        level.swap(nextLevel);
+    }
+
+    // the order the directories are listed in isn't stable
+    std::unordered_set<std::string> seenPaths;
+    for (auto &paths : rootFilePaths)
+    {
+        std::sort(paths.begin(), paths.end());
+        for (auto &path : paths)
+        {
+            if (seenPaths.insert(fs::path(path).lexically_normal().string()).second)
+                filePaths.push_back(std::move(path));
+        }
+    }
+    return success;
+}
@@ -0,0 +1,22 @@
+#include <mutex>
+
+#include "FuncCodeCache.h"
+
+bool FuncCodeCache::fetch(const Key &key, VmWriter &output) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iter = codeByKey.find(key);
+    if (iter == codeByKey.end())
+        return false;
+
+    output.append(iter->second);
+    return true;
+}
+
+void FuncCodeCache::store(const Key &key, const VmWriter &output)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (codeByKey.size() >= maxEntries)
+        codeByKey.clear();
+    codeByKey.try_emplace(key, output.data(), output.size());
+}
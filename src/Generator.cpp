@@ -1,4 +1,7 @@
+#include <atomic>
+
 #include "Generator.h"
+#include "Trace.h"
 
 bool Generator::init(const sourceFileNameType &srcFileName)
 {
@@ -20,55 +23,194 @@ Generator::Generator(const sourceFileNameType &srcFileName, const identifierVect
     init(srcFileName);
 }
 
-void Generator::writeFile()
+void Generator::setOutDir(const std::string &outDir)
 {
-    std::ofstream outFile;
-    outFile.open(outFilePath, std::ios::out);
-    if (!outFile)
-        return; 
+    if (!outDir.empty())
+        outFilePath = (std::filesystem::path(outDir) / outFilePath).string();
+}
 
-    for (const auto &line : outputLines)
-    {
-        outFile << line;
-    }
-    outFile << "\r\n";
+void Generator::finishOutput()
+{
+    mainState.output.append("\r\n", 2);
+}
 
-    outFile.close();
+bool Generator::flushOutput(int fd)
+{
+    const bool written = mainState.output.writeToFd(fd);
+    mainState.output.clear();
+    return written;
 }
 
-void Generator::genForNode(AstNode *astNode)
+void Generator::writeFile()
 {
-    genMapIter it = generationLookup.find(astNode->aType);
-    if (it == generationLookup.end())
+    finishOutput();
+    mainState.output.writeToFile(outFilePath);
+}
+
+void Generator::appendNodeValue(const AstNode *astNode, VmWriter &output)
+{
+    if (std::holds_alternative<int>(astNode->aVal))
+        output.appendInt(std::get<int>(astNode->aVal));
+    else if (std::holds_alternative<std::string>(astNode->aVal))
+        output.append(std::get<std::string>(astNode->aVal));
+}
+
+void Generator::genForNode(AstNode *astNode, GenState &state)
+{
+    const EmitTemplate &tmpl = emitTemplates[(size_t)astNode->aType];
+    if (!tmpl.present)
         return;
-    
-    const std::string &codeLine = it->second;
-    size_t wcardPos = codeLine.find('$');
-    if (wcardPos == std::string::npos)
+
+    if (astNode->aType == AstNodeTypes::aFUNC_DEF)
+        state.curFuncName = std::get<std::string>(astNode->aVal);
+
+    VmWriter &output = state.output;
+    output.append(tmpl.prefix);
+    if (tmpl.hasFuncScope)
     {
-        outputLines.push_back(codeLine);
-        return;
+        output.append(state.curFuncName);
+        output.append("$", 1);
+        output.append(tmpl.infix);
     }
+    if (!tmpl.hasValue)
+        return;
 
     // replacing $ with node value(data)
-    std::string res = codeLine.substr(0, wcardPos) 
-        + astNode->getNodeValueAsString()
-        + codeLine.substr(wcardPos + 1);
-    outputLines.push_back(res);
+    appendNodeValue(astNode, output);
+    output.append(tmpl.suffix);
+}
+
+void Generator::generateCode(AstNode *curRoot, GenState &state)
+{
+    for (auto childNode : curRoot->nChildNodes)
+    {
+        generateCode(childNode, state);
+    }
+    if (curRoot->generatesCode)
+        genForNode(curRoot, state);
 }
 
 void Generator::generateCode(AstNode *curRoot)
+{
+    generateCode(curRoot, mainState);
+}
+
+void Generator::collectFuncNodes(AstNode *curRoot, std::vector<AstNode*> &funcNodes)
 {
     for (auto childNode : curRoot->nChildNodes)
     {
-        generateCode(childNode);
+        if (childNode->aType == AstNodeTypes::aFUNCTION)
+            funcNodes.push_back(childNode);
+        else
+            collectFuncNodes(childNode, funcNodes);
+    }
+    // only function subtrees generate code,
+    // anything above them would be lost here
+    assert(!curRoot->generatesCode || !emitTemplates[(size_t)curRoot->aType].present);
+}
+
+void Generator::generateFuncs(AstNode *curRoot, ThreadPool *pool, FuncCodeCache *funcCache,
+    const FuncCodeCache::FuncKeys *funcKeys)
+{
+    std::vector<AstNode*> funcNodes;
+    collectFuncNodes(curRoot, funcNodes);
+
+    std::vector<GenState> funcStates(funcNodes.size());
+    std::vector<std::chrono::nanoseconds> funcCpuTimes(funcNodes.size());
+    std::atomic<bool> funcsOutOfTime = false;
+    auto generateOrFetch = [&, funcCache, funcKeys](size_t funcIdx)
+    {
+        if (deadline != std::chrono::steady_clock::time_point::max()
+            && (funcsOutOfTime || std::chrono::steady_clock::now() > deadline))
+        {
+            funcsOutOfTime = true;
+            return;
+        }
+
+        // aFUNC_DEF, the first child, has the full name
+        const auto &funcName = std::get<std::string>(funcNodes[funcIdx]->nChildNodes.front()->aVal);
+        const TraceScope trace("codegen", funcName);
+        // none for a function the parser stopped in
+        const auto keyIter = funcKeys != NULL ? funcKeys->find(funcNodes[funcIdx]) :
+            FuncCodeCache::FuncKeys::const_iterator();
+        if (funcCache == NULL || funcKeys == NULL || keyIter == funcKeys->end())
+        {
+            generateCode(funcNodes[funcIdx], funcStates[funcIdx]);
+            return;
+        }
+
+        if (funcCache->fetch(keyIter->second, funcStates[funcIdx].output))
+            return;
+
+        generateCode(funcNodes[funcIdx], funcStates[funcIdx]);
+        funcCache->store(keyIter->second, funcStates[funcIdx].output);
+    };
+    // on the thread generating the function
+    auto generateFunc = [&](size_t funcIdx)
+    {
+        const StageTimer timer;
+        generateOrFetch(funcIdx);
+        funcCpuTimes[funcIdx] = timer.elapsed().cpu;
+    };
+
+    if (pool != NULL)
+    {
+        pool->parallelFor(funcNodes.size(), generateFunc);
+    }
+    else
+    {
+        for (size_t i = 0; i < funcNodes.size(); ++i)
+        {
+            generateFunc(i);
+        }
+    }
+
+    for (const auto &funcCpuTime : funcCpuTimes)
+    {
+        cpuTime += funcCpuTime;
+    }
+
+    if (funcsOutOfTime)
+    {
+        outOfTime = true;
+        return;
+    }
+
+    for (const auto &funcState : funcStates)
+    {
+        mainState.output.append(funcState.output.data(), funcState.output.size());
+    }
+}
+
+void Generator::generatePending(AstNode *curRoot)
+{
+    for (size_t i = curRoot->nEmittedChildren; i < curRoot->nChildNodes.size(); ++i)
+    {
+        generatePending(curRoot->nChildNodes[i]);
     }
     if (curRoot->generatesCode)
-        genForNode(curRoot);
+        genForNode(curRoot, mainState);
+}
+
+void Generator::generate(AstNode *curRoot, ThreadPool *pool, FuncCodeCache *funcCache,
+    const FuncCodeCache::FuncKeys *funcKeys)
+{
+    // function by function also for their trace events
+    if (funcCache != NULL || (pool != NULL && pool->getNumThreads() > 1)
+        || deadline != std::chrono::steady_clock::time_point::max() || getTracing())
+    {
+        generateFuncs(curRoot, pool, funcCache, funcKeys);
+    }
+    else
+    {
+        const StageTimer timer;
+        generateCode(curRoot);
+        cpuTime += timer.elapsed().cpu;
+    }
 }
 
-void Generator::generateAndWrite(AstNode *curRoot)
+void Generator::generateAndWrite(AstNode *curRoot, ThreadPool *pool)
 {
-    generateCode(curRoot);
+    generate(curRoot, pool);
     writeFile();
 }
@@ -0,0 +1,35 @@
+#include "IncrementalBuild.h"
+#include "CompilerContext.h"
+
+IncrementalBuild::IncrementalBuild(const CompilerOptions &options, ThreadPool &pool)
+    : options(options), pool(pool), records(options)
+{
+    if (!options.rebuildAll)
+        records.load(BuildRecords::recordsPath(options.outDir));
+}
+
+bool IncrementalBuild::build(const std::vector<std::string> &filePaths, std::ostream &out, std::ostream &err)
+{
+    std::vector<SourceUnit> units(filePaths.size());
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        units[i].filePath = filePaths[i];
+    }
+
+    CompilerContext context(options);
+    BatchIO io(pool, options.ioUring);
+    lexUnits(pool, units, options.limits, false, &caches.sources, &io);
+    parseSignatures(context, pool, units, options.scheduleReport ? &out : NULL);
+    const size_t numGenerated = records.markOutOfDate(context, units, options.outDir);
+    generateUnits(context, pool, units, false, &io, &caches.funcs);
+
+    records.update(units);
+    records.save(BuildRecords::recordsPath(options.outDir));
+
+    for (const auto &unit : units)
+    {
+        err << unit.diagnostics.str();
+    }
+    out << "Compiled " << numGenerated << " of " << units.size() << " files\n";
+    return unitsSucceeded(units);
+}
@@ -7,641 +7,649 @@
 #include <filesystem>
 #include <cassert>
 #include <algorithm>
-#include <filesystem>
+#include <memory>
+#include <map>
+#include <mutex>
 
 #include "Utils.h"
 #include "JackCompilerTypes.h"
-#include "Parser.h"
-#include "Generator.h"
+#include "CompileDriver.h"
+#include "CompileServer.h"
+#include "BuildRecords.h"
+#include "IncrementalBuild.h"
+#include "DirWatcher.h"
+#include "FileDiscovery.h"
+#include "BatchBuild.h"
+#include "PipeCompile.h"
+#include "ShardedBuild.h"
+#include "StreamCompile.h"
+#include "AllocCounter.h"
+#include "Trace.h"
 #include "DEBUG_CONTROL.h"
-#include "UsefulString.h"
-
-namespace fs = std::filesystem;
 
-class Lexer
+// Compiles the files as one program, everything it shares
+// between them lives in context. The pool and the caches can be
+// shared by several compilations running at the same time.
+// Without execPath the AST log file isn't written.
+// discoveryTime is what finding the files took, for --time-report.
+bool compileFiles(CompilerContext &context, ThreadPool &pool, CompileCaches *caches,
+    const std::vector<std::string> &filePaths, const StageTime &discoveryTime, const char *execPath,
+    std::ostream &out, std::ostream &err)
 {
-private:
-    std::string curLine;
-    bool moreLinesComing = true;
-    unsigned int labelUniqueId = 0;
-
-    std::string curFileName;
-    std::vector<std::string> filePaths;
-    bool inputIsDir = false;
+    // the process' allocations and CPU time, concurrent compilations' too
+    const AllocCount allocsBefore = getAllocCount();
+    const bool processCpu = true;
+    const StageTimer buildTimer(processCpu);
 
-private:
-    bool isJackFile(const std::string &path) const
+    std::vector<SourceUnit> units(filePaths.size());
+    for (size_t i = 0; i < units.size(); ++i)
     {
-        std::string pathStr(path);
-        std::string fileExt = pathStr.substr(pathStr.find_last_of("."));
-        return fileExt == ".jack";
+        units[i].filePath = filePaths[i];
     }
 
-public:
+    // only the out of date files are generated,
+    // the others keep their outputs from before
+    const std::string &outDir = context.getOptions().outDir;
+    BuildRecords records(context.getOptions());
+    if (!context.getOptions().rebuildAll)
+        records.load(BuildRecords::recordsPath(outDir));
 
-    static int addKeyword(LexerState &lexState, std::string ident)
-    {
-        lexState.identifiers.push_back(ident);
-        return lexState.identifiers.size() - 1;
-    }
+    BatchIO io(pool, context.getOptions().ioUring);
+    lexUnits(pool, units, context.getOptions().limits, false, caches != NULL ? &caches->sources : NULL, &io);
+    parseSignatures(context, pool, units, context.getOptions().scheduleReport ? &out : NULL);
+    records.markOutOfDate(context, units, outDir);
+    generateUnits(context, pool, units, false, &io, caches != NULL ? &caches->funcs : NULL);
+    const bool success = unitsSucceeded(units);
 
-    void addFilesFromPath(const char *path)
-    {
-        std::error_code ec;
-        if (fs::is_directory(path, ec))
-        {
-            inputIsDir = true;
-            for (const auto &entry : fs::directory_iterator(path))
-            {
-                if (!fs::is_directory(entry.path(), ec) && isJackFile(entry.path().native()))
-                    filePaths.push_back(entry.path().native());
-            }
-        }
-        else
-            filePaths.push_back(path);
-    }
+    records.update(units);
+    records.save(BuildRecords::recordsPath(outDir));
 
-    bool init(const char *srcPath, const char *libsPath)
+    for (const auto &unit : units)
     {
-        // first libraries
-        // checking null or empty
-        if (libsPath != NULL && libsPath[0] != '\0')
-            addFilesFromPath(libsPath);
-
-        // then sources
-        addFilesFromPath(srcPath);
-        
-        return true;
+        out << unit.lexLog.str() << unit.log.str();
+        err << unit.diagnostics.str();
     }
 
-    bool getMoreLinesComing() const
+    if (context.getOptions().stats)
     {
-        return moreLinesComing;
-    }
-    const std::vector<std::string> &getFilePaths() const
-    {
-        return filePaths;
-    }
-    const bool getInputIsDir() const
-    {
-        return inputIsDir;
+        const AllocCount allocsAfter = getAllocCount();
+        printStats(units, out);
+        out << "allocations: " << allocsAfter.allocs - allocsBefore.allocs << " (" <<
+            allocsAfter.bytes - allocsBefore.bytes << " bytes)\n";
     }
 
-    void setCurFileName(std::string curFilePath)
+    if (context.getOptions().timeReport)
     {
-        // +1 to discard '/'
-        size_t idx = curFilePath.find_first_of("/");
-        assert(idx + 1 < curFilePath.size());
-        std::string curDirFp = curFilePath.substr(idx + 1);
-
-        // discarding the extension
-        const size_t fNameStartIdx = 0;
-        curFileName = curDirFp.substr(fNameStartIdx, curDirFp.find_first_of(".") - fNameStartIdx);
+        StageTimes buildTimes;
+        buildTimes[BuildStages::bsDISCOVERY] = discoveryTime;
+        buildTimes[BuildStages::bsREAD] = io.getReadTime();
+        buildTimes[BuildStages::bsWRITE] = io.getWriteTime();
+        StageTime total = buildTimer.elapsed();
+        total += discoveryTime;
+        printTimeReport(units, buildTimes, total, out);
     }
 
-    const std::string &getCurFileName() const
-    {
-        return curFileName;
-    }
+#if defined(LOGGING) && !defined(LEXER_ONLY)
+    if (execPath == NULL)
+        return success;
 
-    void resetForFile()
-    {
-        moreLinesComing = true;
-    }
+    namespace fs = std::filesystem;
+    // Get the directory where the executable is located
+    fs::path exe_dir = fs::absolute(fs::path(execPath)).parent_path();
+    // Create a file in the same directory
+    std::string f = "ast_nodes";
+    fs::path file_path = exe_dir / f;
+    std::ofstream out_file(file_path);
 
-    std::string getCurLine() const
+    out << "Logging ast nodes to file: " << f << '\n';
+    for (const auto &unit : units)
     {
-        return curLine;
+        out_file << unit.log.str();
     }
+    out << "Logging finished\n";
+#endif
+
+    return success;
+}
+
+// first the libraries, then the sources
+std::vector<std::string> sourceRoots(const CompilerArgs &args)
+{
+    std::vector<std::string> roots;
+    // checking null or empty
+    if (args.libsPath != NULL && args.libsPath[0] != '\0')
+        roots.push_back(args.libsPath);
+    roots.push_back(args.srcPath);
+    roots.insert(roots.end(), args.moreSrcPaths.begin(), args.moreSrcPaths.end());
+    return roots;
+}
 
-    bool lexNextLine(std::ifstream *jackFile, LexerState &lexState)
+bool compilerCtrl(const char *execPath, const CompilerArgs &args, ThreadPool &pool,
+    CompileCaches *caches, std::ostream &out, std::ostream &err)
+{
+    const bool processCpu = true;
+    const StageTimer discoveryTimer(processCpu);
+    std::vector<std::string> filePaths;
     {
-        std::string line;
-        if (!std::getline(*jackFile, line))
-        {
-            moreLinesComing = false;
+        const TraceScope stageTrace("stage", "discovery");
+        if (!discoverFiles(sourceRoots(args), args.discovery, pool, filePaths, NULL, err))
             return false;
-        }
-        std::cout << line << '\n';
-        return lexLine(line, lexState);
     }
+    const StageTime discoveryTime = discoveryTimer.elapsed();
 
-    void initStateBeh(UsefulString &ustr, LexerState &lexState)
+    CompilerContext context(args.options);
+    return compileFiles(context, pool, caches, filePaths, discoveryTime, execPath, out, err);
+}
+
+// Builds, then builds again whatever is out of date after every change
+// in the source or the library directories, until watching fails
+bool watchCtrl(const CompilerArgs &args, ThreadPool &pool)
+{
+    namespace fs = std::filesystem;
+
+    DirWatcher watcher(".jack");
+    IncrementalBuild build(args.options, pool);
+    while (true)
     {
-        ustr.skipSpaces();
-        if (ustr.isEol())
-        {
-            lexState.fsmFinished = true;
-            return;
-        }
+        // the directories walked are watched, again every time
+        // since the trees can have new ones (the same
+        // directory added twice is watched once)
+        const std::vector<std::string> roots = sourceRoots(args);
+        std::vector<std::string> filePaths;
+        std::vector<std::string> dirPaths;
+        if (!discoverFiles(roots, args.discovery, pool, filePaths, &dirPaths))
+            return false;
 
-        char c = ustr.getChar();
-        if (isalpha(c) || c == '_')
-        {
-            ustr.fwd();
-            lexState.addBuff(c);
-            lexState.fsmCurState = LexFsmStates::sLETTERS;
-        }
-        else if (isdigit(c))
+        for (const auto &root : roots)
         {
-            ustr.fwd();
-            lexState.addBuff(c);
-            lexState.fsmCurState = LexFsmStates::sDIGITS;
+            // for a single file its directory
+            std::error_code ec;
+            if (!fs::is_directory(root, ec))
+                dirPaths.push_back(fs::path(root).parent_path().string());
         }
-        else
+        for (const auto &dirPath : dirPaths)
         {
-            // epsilon transition
-            lexState.fsmCurState = LexFsmStates::sSYMBOL;
+            if (!watcher.addDir(dirPath.empty() ? "." : dirPath))
+                return false;
         }
+
+        build.build(filePaths, std::cout, std::cerr);
+        std::cout << "Watching for changes" << std::endl;
+
+        if (!watcher.waitForChanges())
+            return false;
     }
-    void lettersStateBeh(UsefulString &ustr, LexerState &lexState)
-    {
-        if (ustr.isEol())
-        {
-            lexState.fsmFinished = true;
-            return;
-        }
+}
 
-        char c = ustr.getChar();
-        if (isalpha(c) || c == '_')
-        {
-            ustr.fwd();
-            lexState.addBuff(c);
-            lexState.fsmCurState = LexFsmStates::sLETTERS;
-        }
-        else if (isdigit(c))
-        {
-            ustr.fwd();
-            lexState.addBuff(c);
-            lexState.fsmCurState = LexFsmStates::sDIGITS_AFTER_ALPHA;
-        }
-        else
-        {
-            // epsilon transition
-            lexState.fsmCurState = LexFsmStates::sSYMBOL;
-        }
+// The files are found with threads that are gone
+// again when the workers are forked
+bool shardCtrl(const CompilerArgs &args)
+{
+    std::vector<std::string> filePaths;
+    {
+        ThreadPool pool(args.options.jobs);
+        if (!discoverFiles(sourceRoots(args), args.discovery, pool, filePaths))
+            return false;
     }
-    void digitsAfterAlphaStateBeh(UsefulString &ustr, LexerState &lexState)
+    return shardedCompile(args.options, filePaths, args.shards, std::cout, std::cerr);
+}
+
+// Compiles the files with at most a function of each in memory
+bool streamCtrl(const CompilerArgs &args, ThreadPool &pool)
+{
+    std::vector<std::string> filePaths;
     {
-        if (ustr.isEol())
-        {
-            lexState.fsmFinished = true;
-            return;
-        }
+        const TraceScope stageTrace("stage", "discovery");
+        if (!discoverFiles(sourceRoots(args), args.discovery, pool, filePaths))
+            return false;
+    }
+    return streamCompile(args.options, filePaths, pool, std::cout, std::cerr);
+}
 
-        char c = ustr.getChar();
-        if (isdigit(c))
+// Compiles the projects of the manifest, the summary goes to stdout
+bool batchCtrl(const CompilerArgs &args, ThreadPool &pool)
+{
+    std::vector<BatchProject> projects;
+    if (!loadManifest(args.batchPath, projects, std::cerr))
+        return false;
+
+    std::vector<std::string> libsPaths;
+    if (args.libsPath != NULL && args.libsPath[0] != '\0')
+        libsPaths.push_back(args.libsPath);
+
+    BatchBuild batch(args.options, args.discovery, pool);
+    if (!batch.loadLibs(libsPaths, std::cerr))
+        return false;
+
+    const bool success = batch.build(projects);
+    BatchBuild::writeSummary(projects, std::cout);
+    return success;
+}
+
+// the limit a --max-... option sets, NULL for other arguments
+size_t *limitOption(const std::string &arg, ResourceLimits &limits)
+{
+    if (arg == "--max-file-size")
+        return &limits.maxFileSize;
+    if (arg == "--max-tokens")
+        return &limits.maxTokens;
+    if (arg == "--max-ast-nodes")
+        return &limits.maxAstNodes;
+    if (arg == "--max-depth")
+        return &limits.maxNestingDepth;
+    if (arg == "--max-file-ms")
+        return &limits.maxFileMs;
+    return NULL;
+}
+
+// Usage: JackCompiler [options] <sources_path> [libs_path]
+//        JackCompiler --watch [options] <sources_path> [libs_path]
+//        JackCompiler --batch <manifest> [options] [libs_path]
+//        JackCompiler --pipe [options] [libs_path]
+//        JackCompiler [-j N] --serve <socket>
+//        JackCompiler --connect <socket> [options] <sources_path> [libs_path]
+// options: --direct, --rebuild, --no-io-uring, -j N, --shards N, --stream, --schedule-report, --stats,
+//          --time-report, --trace-out <file>, --recursive, --src <path>, --include <glob>, --exclude <glob>, --max-file-size <bytes>,
+//          --max-tokens N, --max-ast-nodes N, --max-depth N, --max-file-ms N (0: no limit)
+bool parseArgs(int argc, char *argv[], CompilerArgs &args, std::ostream &err = std::cerr)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--direct")
         {
-            ustr.fwd();
-            lexState.addBuff(c);
-            lexState.fsmCurState = LexFsmStates::sDIGITS_AFTER_ALPHA;
+            args.options.directEmit = true;
         }
-        else if (isalpha(c) || c == '_')
+        else if (arg == "--watch")
         {
-            ustr.fwd();
-            lexState.addBuff(c);
-            lexState.fsmCurState = LexFsmStates::sLETTERS;
+            args.watch = true;
         }
-        else
+        else if (arg == "--rebuild")
         {
-            // epsilon transition
-            lexState.fsmCurState = LexFsmStates::sSYMBOL;
+            args.options.rebuildAll = true;
         }
-    }
-    void digitsStateBeh(UsefulString &ustr, LexerState &lexState)
-    {
-        if (ustr.isEol())
+        else if (arg == "--no-io-uring")
         {
-            lexState.fsmFinished = true;
-            return;
+            args.options.ioUring = false;
         }
-
-        char c = ustr.getChar();
-        if (isdigit(c))
+        else if (arg == "--schedule-report")
         {
-            ustr.fwd();
-            lexState.addBuff(c);
-            lexState.fsmCurState = LexFsmStates::sDIGITS;
+            args.options.scheduleReport = true;
         }
-        else
+        else if (arg == "--stats")
         {
-            // epsilon transition
-            lexState.fsmCurState = LexFsmStates::sSYMBOL;
+            args.options.stats = true;
         }
-    }
-
-    void handleBuffer(LexerState &lexState)
-    {
-        std::string inBuff(lexState.buffer, lexState.bIdx);
-        tokenMapIter it = tokenLookup.find(inBuff);
-
-        // MEMORY LEAK SOMEWHERE: fail_1.jack
-        // lexState.buffer[0] != 0, but
-        // lexState.bIdx == 0
-        // occurs sometimes
-
-        // known keyword
-        if (it != tokenLookup.end())
+        else if (arg == "--time-report")
         {
-            lexState.tokens.emplace_back(lexState.lexedLineIdx, it->second);
-            return;
+            args.options.timeReport = true;
         }
-
-        // a number
-        char * pEnd = NULL;
-        int num = strtol(inBuff.c_str(), &pEnd, 10);
-        if (!*pEnd)
+        else if (arg == "--stream")
         {
-            lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tNUMBER, num);
+            args.stream = true;
         }
-        else
+        else if (arg == "--pipe")
         {
-            const auto identPosNum = vectContains(lexState.identifiers, inBuff);
-            // known identifier
-            if (identPosNum >= 0)
-            {
-                lexState.tokens.emplace_back(lexState.lexedLineIdx, 
-                    TokenTypes::tIDENTIFIER, identPosNum);
-            }
-            else
-            {
-                lexState.identifiers.push_back(inBuff);
-                lexState.tokens.emplace_back(lexState.lexedLineIdx, 
-                    TokenTypes::tIDENTIFIER, lexState.identifiers.size()-1);
-            }
+            args.pipe = true;
         }
-        // Only considered a term (alhpanumeric)
-        // if we are on the right handside.
-        // TODO: see if can be moved too Parser,
-        // otherwise we are bringing semantics
-        // to syntactic analyzer.
-        if (lexState.onRhs)
-            lexState.lastOperTermIsOper = false;
-    }
-
-    void symbolStateBeh(UsefulString &ustr, LexerState &lexState)
-    {
-        if (!lexState.buffEmpty())
+        else if (arg == "--recursive")
         {
-            handleBuffer(lexState);
-            lexState.flush();
+            args.discovery.recursive = true;
         }
-
-        ustr.skipSpaces();
-        if (ustr.isEol())
+        else if (arg == "--serve" || arg == "--connect")
         {
-            lexState.fsmFinished = true;
-            return;
+            if (i + 1 >= argc)
+            {
+                err << "Missing socket path: " << arg << '\n';
+                return false;
+            }
+            (arg == "--serve" ? args.servePath : args.connectPath) = argv[++i];
         }
-
-        char c = ustr.getChar();
-        if (isalpha(c) || c == '_' || isdigit(c))
+        else if (arg == "--batch")
         {
-            // epsilon transition
-            lexState.fsmCurState = LexFsmStates::sINIT;
-            return;
+            if (i + 1 >= argc)
+            {
+                err << "Missing manifest path: " << arg << '\n';
+                return false;
+            }
+            args.batchPath = argv[++i];
         }
-
-        if (c == '/')
+        else if (arg == "--trace-out")
         {
-            ustr.fwd();
-            if (ustr.getChar() == '/')
+            if (i + 1 >= argc)
             {
-                lexState.fsmCurState = LexFsmStates::sCOMMENT;
-                return;
+                err << "Missing trace path: " << arg << '\n';
+                return false;
             }
-            ustr.bwd();
+            args.traceOutPath = argv[++i];
         }
-
-        std::string s(1, c);
-        tokenMapIter it = tokenLookup.find(s);
-        if (it != tokenLookup.end())
-        {   
-            // only updating if on the right hand side
-            if (lexState.onRhs)
+        else if (arg == "--src")
+        {
+            if (i + 1 >= argc)
             {
-                if (it->first[0] == ')')
-                    lexState.lastOperTermIsOper = false;
-                // a hack to treat - as negation and not subtraction after ','
-                // e.g. calc(14, -a);
-                else if (it->first[0] == ',')
-                    lexState.lastOperTermIsOper = true;
+                err << "Missing source path: " << arg << '\n';
+                return false;
             }
-
-            // can't happen when the above triggered
-            // so the order doesn't matter
-            if (it->second == TokenTypes::tEQUAL 
-                // expr/term start withing ()
-                // e.g. calc(-25)
-                || it->second == TokenTypes::tLPR)
+            args.moreSrcPaths.push_back(argv[++i]);
+        }
+        else if (arg == "--include" || arg == "--exclude")
+        {
+            if (i + 1 >= argc)
             {
-                lexState.onRhs = true;
+                err << "Missing glob: " << arg << '\n';
+                return false;
             }
-
-            if (it->second == TokenTypes::tMINUS)
+            auto &globs = arg == "--include" ? args.discovery.includes : args.discovery.excludes;
+            globs.push_back(argv[++i]);
+        }
+        else if (arg == "--shards")
+        {
+            char *pEnd = NULL;
+            const char *shardsStr = i + 1 < argc ? argv[++i] : "";
+            const long shards = strtol(shardsStr, &pEnd, 10);
+            if (*shardsStr == '\0' || *pEnd != '\0' || shards < 1)
             {
-                if (lexState.lastOperTermIsOper)
-                    lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tNEG_MINUS);
-                else
-                {
-                    lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tMINUS);
-                    lexState.lastOperTermIsOper = true;
-                }
+                err << "Invalid number of shards: " << shardsStr << '\n';
+                return false;
             }
-            else
-            {
-                lexState.tokens.emplace_back(lexState.lexedLineIdx, it->second);
-                if (isbinaryperator(it->second))
-                    lexState.lastOperTermIsOper = true;
-            }   
+            args.shards = shards;
         }
-        else
+        else if (size_t *limit = limitOption(arg, args.options.limits))
         {
-            lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tUNKNOWN_SYMBOL);
+            char *pEnd = NULL;
+            const char *limitStr = i + 1 < argc ? argv[++i] : "";
+            const long long value = strtoll(limitStr, &pEnd, 10);
+            if (*limitStr == '\0' || *pEnd != '\0' || value < 0)
+            {
+                err << "Invalid limit: " << arg << ' ' << limitStr << '\n';
+                return false;
+            }
+            *limit = value;
         }
-
-        ustr.fwd();
-        // epsilon transition
-        lexState.fsmCurState = LexFsmStates::sSYMBOL;
-    }
-
-    void commentStateBeh(UsefulString &ustr, LexerState &lexState)
-    {
-        if (ustr.isEol())
+        else if (arg.rfind("-j", 0) == 0)
         {
-            lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tDIV);
-            lexState.fsmFinished = true;
-            return;
+            // both "-j N" and "-jN"
+            const char *jobsStr = arg.size() > 2 ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            char *pEnd = NULL;
+            const long jobs = strtol(jobsStr, &pEnd, 10);
+            if (*jobsStr == '\0' || *pEnd != '\0' || jobs < 1)
+            {
+                err << "Invalid number of jobs: " << jobsStr << '\n';
+                return false;
+            }
+            args.options.jobs = jobs;
         }
-        
-        char c = ustr.getChar();
-        // no more tokens on this line, finishing
-        if (c == '/')
+        else if (arg.rfind("--", 0) == 0)
         {
-            lexState.commentOpen = true;
-            lexState.fsmFinished = true;
+            err << "Unknown option: " << arg << '\n';
+            return false;
         }
-        else if (c == '*')
+        else if (args.srcPath == NULL)
         {
-            lexState.commentOpen = true;
-            lexState.mlineComment = true;
-
-            ustr.fwd();
-            lexState.fsmCurState = LexFsmStates::sMLINE_COMMENT;
+            args.srcPath = argv[i];
         }
-        else
+        else if (args.libsPath == NULL)
         {
-            lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tDIV);
-
-            ustr.fwd();
-            lexState.fsmCurState = LexFsmStates::sSYMBOL;
+            args.libsPath = argv[i];
         }
     }
 
-    void mlineCommentStateBeh(UsefulString &ustr, LexerState &lexState)
+    if (args.shards > 0 && (args.watch || args.batchPath != NULL || args.pipe || args.servePath != NULL))
     {
-        if (ustr.isEol())
-        {
-            lexState.fsmFinished = true;
-            return;
-        }
-
-        char c = ustr.getChar();
-        std::cout << c << '\n';
-        
-        bool commentClosed = false;
-        do
-        {
-            std::cout << "Enter fwd?\n";
-            c = ustr.getChar();
-            if (c == '*')
-            {
-                if (!ustr.fwd())
-                    break;
-                c = ustr.getChar();
-                // comment end
-                if (c == '/')
-                {
-                    commentClosed = true;
-                    break;
-                }
-            }
-        } while (ustr.fwd());
-
-        if (commentClosed)
-        {
-            lexState.commentOpen = false;
-            lexState.mlineComment = false;
-            
-            ustr.fwd();
-            lexState.fsmCurState = LexFsmStates::sINIT;
-        }
+        err << "--shards is for a single build\n";
+        return false;
     }
-
-    bool lexLine(const std::string &line, LexerState &lexState)
+    if (args.stream && (args.shards > 0 || args.watch || args.batchPath != NULL || args.pipe ||
+        args.servePath != NULL))
     {
-        UsefulString ustr(line);
-
-        std::stringstream debug_strm;
-        while (!lexState.fsmFinished)
-        {
-            debug_strm.str(std::string());
-            switch (lexState.fsmCurState)
-            {
-            case LexFsmStates::sINIT:
-                debug_strm << "sINIT hits\n";
-                initStateBeh(ustr, lexState);
-                break;
-
-            case LexFsmStates::sLETTERS:
-                debug_strm << "sLETTERS hits\n";
-                lettersStateBeh(ustr, lexState);
-                break;
-
-            case LexFsmStates::sDIGITS_AFTER_ALPHA:
-                std::cout << "sDIGITS_AFTER_ALPHA hits\n";
-                digitsAfterAlphaStateBeh(ustr, lexState);
-                break;
-
-            case LexFsmStates::sDIGITS:
-                debug_strm << "sDIGITS hits\n";
-                digitsStateBeh(ustr, lexState);
-                break;
-
-            case LexFsmStates::sSYMBOL:
-                debug_strm << "sSYMBOL hits\n";
-                symbolStateBeh(ustr, lexState);
-                break;
-
-            case LexFsmStates::sCOMMENT:
-                debug_strm << "sCOMMENT hits\n";
-                commentStateBeh(ustr, lexState);
-                break;
-
-            case LexFsmStates::sMLINE_COMMENT:
-                debug_strm << "sMLINE_COMMENT hits\n";
-                mlineCommentStateBeh(ustr, lexState);
-                break;
-            }
-#ifdef LEXER_DEBUG
-            std::cout << debug_strm.str();
-#endif
-        }
-
-        if (!lexState.buffEmpty())
+        err << "--stream is for a single build\n";
+        return false;
+    }
+    // the stages of the other builds aren't the in-process ones
+    if (args.options.timeReport && (args.shards > 0 || args.stream || args.watch ||
+        args.batchPath != NULL || args.pipe))
+    {
+        err << "--time-report is for a single in-process build\n";
+        return false;
+    }
+    // written when the build ends, by this process
+    if (args.traceOutPath != NULL && (args.shards > 0 || args.watch || args.servePath != NULL ||
+        args.connectPath != NULL))
+    {
+        err << "--trace-out is for an in-process build that ends\n";
+        return false;
+    }
+    if (args.batchPath != NULL || args.pipe)
+    {
+        // the sources are in the manifest or come through stdin
+        if (args.libsPath != NULL)
         {
-            handleBuffer(lexState);
+            err << "Expected only the libraries with " << (args.pipe ? "--pipe" : "--batch") << '\n';
+            return false;
         }
-
-        lexState.lexedLineIdx++;
-
-#ifdef LEXER_DEBUG
-        std::cout << "Finished tokenizing line: " << line << '\n';
-        std::cout << "Got this many tokens now: " << lexState.tokens.size() << '\n';
-#endif
+        args.libsPath = args.srcPath;
+        args.srcPath = NULL;
         return true;
     }
+    return args.srcPath != NULL || args.servePath != NULL;
+}
+
+// What a compile server keeps warm between the requests:
+// the threads, the lexed files, the code of the functions
+// and the resolved libraries
+struct ServerState
+{
+    // the server's own, its --max-... a request can only lower
+    CompilerOptions options;
+    ThreadPool pool;
+    CompileCaches caches;
+
+    // by path and discovery options: lexed, through phase 1 and
+    // generated with the server's options, loaded again once
+    // one of their files changes
+    std::mutex libsMutex;
+    std::map<std::string, std::shared_ptr<const BatchBuild>> libs;
+
+    // the requests for a directory run one at a time,
+    // they'd write the same outputs and build records
+    std::mutex dirsMutex;
+    std::map<std::string, std::shared_ptr<std::mutex>> dirLocks;
+
+    explicit ServerState(const CompilerOptions &options) : options(options), pool(options.jobs)
+    {}
 };
 
-bool tokenize(const std::string &filePath, Lexer &lexer, LexerState &lexState)
+// the libraries in libsPath, NULL if they don't compile
+std::shared_ptr<const BatchBuild> warmLibs(ServerState &state, const std::string &libsPath,
+    const DiscoveryOptions &discovery, std::ostream &err)
 {
-    #ifdef LEXER_DEBUG
-    auto printTokens = [](const tokensVect &tokens)
+    std::string key = libsPath + '\0' + (discovery.recursive ? 'r' : '-');
+    for (const auto &glob : discovery.includes)
     {
-        for (auto elem : tokens)
-        {
-            std::cout << "Token type: "  << tType_to_string(elem.tType) << '\n';
-            if (elem.tVal.has_value())    
-                std::cout << "Token val: " << elem.tVal.value() << '\n';
-            else
-                std::cout << "Token val: none\n";
-        }
-        std::cout << '\n';
-    };
-#endif
-    auto printIdentifiers = [](const identifierVect &identifiers)
+        key += "\0+" + glob;
+    }
+    for (const auto &glob : discovery.excludes)
     {
-        int i = 0;
-        for (auto elem : identifiers)
-        {
-            std::cout << "Identifier idx: "  << i << '\n';
-            std::cout << "Identifier val: "  << elem << '\n';            
-            i++;
-        }
-        std::cout << '\n';
-    };
-
-    std::ifstream jackFile;
-    jackFile.open(filePath, std::ios::in);
-    if (!jackFile)
-        return false;
-
-    std::cout << filePath << '\n';
-    lexer.setCurFileName(filePath);
+        key += "\0-" + glob;
+    }
 
-    while (lexer.getMoreLinesComing())
-    {
-        const bool res = lexer.lexNextLine(&jackFile, lexState);
-        // parsing of the current line failed
-        if (!res)
-        {
-            lexState.reset();
-            continue;
-        }
+    std::lock_guard<std::mutex> lock(state.libsMutex);
+    auto &libs = state.libs[key];
+    if (libs != NULL && libs->libsUnchanged({libsPath}))
+        return libs;
 
-#ifdef LEXER_DEBUG
-        printTokens(lexState.tokens);
-        printIdentifiers(lexState.identifiers);
-#endif
+    auto loaded = std::make_shared<BatchBuild>(state.options, discovery, state.pool);
+    libs = NULL;
+    if (loaded->loadLibs({libsPath}, err))
+        libs = loaded;
+    return libs;
+}
 
-        lexState.reset();
-    }
+// The sources compiled in a context layered on the libraries',
+// the libraries' code is written along
+bool compileOnLibs(ServerState &state, const BatchBuild &libs, const CompilerArgs &args,
+    std::ostream &out, std::ostream &err)
+{
+    CompilerArgs srcArgs = args;
+    srcArgs.libsPath = NULL;
+    const bool processCpu = true;
+    const StageTimer discoveryTimer(processCpu);
+    std::vector<std::string> filePaths;
+    if (!discoverFiles(sourceRoots(srcArgs), args.discovery, state.pool, filePaths, NULL, err))
+        return false;
+    const StageTime discoveryTime = discoveryTimer.elapsed();
 
-    jackFile.close();
-    return true;
+    CompilerContext context(libs.getLibsContext(), args.options);
+    const bool success = compileFiles(context, state.pool, &state.caches, filePaths, discoveryTime,
+        NULL, out, err);
+    BatchIO io(state.pool, args.options.ioUring);
+    return libs.writeLibs(args.options.outDir, io, err) && success;
 }
 
-bool compilerCtrl(const char *execPath, const char *pathIn, const char *libsPath)
+// the lower of each limit, no limit being the highest
+ResourceLimits lowerLimits(const ResourceLimits &lhs, const ResourceLimits &rhs)
 {
-    Lexer lexer;
-    LexerState lexState;
+    auto lower = [](size_t lhsLimit, size_t rhsLimit)
+    {
+        if (lhsLimit == 0 || rhsLimit == 0)
+            return std::max(lhsLimit, rhsLimit);
+        return std::min(lhsLimit, rhsLimit);
+    };
 
-    const unsigned int arrayLib_className_id = Lexer::addKeyword(lexState, "Array");
+    ResourceLimits limits;
+    limits.maxFileSize = lower(lhs.maxFileSize, rhs.maxFileSize);
+    limits.maxTokens = lower(lhs.maxTokens, rhs.maxTokens);
+    limits.maxAstNodes = lower(lhs.maxAstNodes, rhs.maxAstNodes);
+    limits.maxNestingDepth = lower(lhs.maxNestingDepth, rhs.maxNestingDepth);
+    limits.maxFileMs = lower(lhs.maxFileMs, rhs.maxFileMs);
+    return limits;
+}
 
-    Parser parser;
-    // for implicit argument to all class methods, is in a way a "variable name"
-    parser.thisNameID = Lexer::addKeyword(lexState, "this");
-    parser.loadArrSysClass(arrayLib_className_id);
+// One --connect request, compiled the way the command line would
+// in the client's working directory. The pool is the server's,
+// -j of the request doesn't change it and its limits are capped by the server's.
+// The libraries are the server's resolved ones, the requests
+// for the same directory are served one after the other.
+int serveRequest(ServerState &state, const std::vector<std::string> &reqArgs,
+    const std::string &workDir, std::ostream &out, std::ostream &err)
+{
+    namespace fs = std::filesystem;
 
-    if (!lexer.init(pathIn, libsPath))
+    std::vector<char*> argv{const_cast<char*>("JackCompiler")};
+    for (const auto &arg : reqArgs)
     {
-        // TODO: error
-        return false;
+        argv.push_back(const_cast<char*>(arg.c_str()));
     }
 
-    unsigned int tokensOffset = 0;
-    for (const auto &filePath : lexer.getFilePaths())
+    CompilerArgs args;
+    if (!parseArgs(argv.size(), argv.data(), args, err))
+        return 1;
+    if (args.servePath != NULL || args.watch || args.batchPath != NULL || args.pipe ||
+        args.shards > 0 || args.stream || args.srcPath == NULL)
     {
-        if (!tokenize(filePath, lexer, lexState))
-        {
-            continue;
-        }
-
-        lexer.resetForFile();
-
-#ifndef LEXER_ONLY
-
-        auto *astRoot = parser.buildAST(lexState.tokens, lexState.identifiers, tokensOffset);
-        tokensOffset = lexState.tokens.size();
-
-    #ifdef DEBUG
-        parser.printAST();
-    #endif
+        err << "Expected sources to compile\n";
+        return 1;
+    }
 
-    #ifdef LOGGING
-        namespace fs = std::filesystem;
-        // Get the directory where the executable is located
-        fs::path exe_dir = fs::absolute(fs::path(execPath)).parent_path();
-        // Create a file in the same directory
-        std::string f = "ast_nodes";
-        fs::path file_path = exe_dir / f;
-        std::ofstream out_file(file_path);
+    // relative paths are the client's
+    const std::string srcPath = (fs::path(workDir) / args.srcPath).lexically_normal().string();
+    std::string libsPath;
+    args.srcPath = srcPath.c_str();
+    if (args.libsPath != NULL && args.libsPath[0] != '\0')
+    {
+        libsPath = (fs::path(workDir) / args.libsPath).lexically_normal().string();
+        args.libsPath = libsPath.c_str();
+    }
+    std::vector<std::string> moreSrcPaths;
+    for (const char *path : args.moreSrcPaths)
+    {
+        moreSrcPaths.push_back((fs::path(workDir) / path).lexically_normal().string());
+    }
+    for (size_t i = 0; i < moreSrcPaths.size(); ++i)
+    {
+        args.moreSrcPaths[i] = moreSrcPaths[i].c_str();
+    }
+    args.options.outDir = workDir;
+    args.options.limits = lowerLimits(state.options.limits, args.options.limits);
 
-        std::cout << "Logging ast nodes to file: " << f << '\n';
-        std::streambuf* original_cout_buffer = std::cout.rdbuf();
-        std::cout.rdbuf(out_file.rdbuf());
-        parser.printAST();
-        // Restore std::cout to the original buffer (console)
-        std::cout.rdbuf(original_cout_buffer);
-        std::cout << "Logging finished\n";
-    #endif
+    std::shared_ptr<std::mutex> dirLock;
+    {
+        std::lock_guard<std::mutex> lock(state.dirsMutex);
+        auto &entry = state.dirLocks[workDir];
+        if (entry == NULL)
+            entry = std::make_shared<std::mutex>();
+        dirLock = entry;
+    }
+    std::lock_guard<std::mutex> dirGuard(*dirLock);
 
-        Generator generator(lexer.getCurFileName(), lexState.identifiers);
-        generator.generateAndWrite(astRoot);
+    if (args.libsPath == NULL)
+        return compilerCtrl(NULL, args, state.pool, &state.caches, out, err) ? 0 : 1;
 
-        parser.resetState();
-#endif
+    const auto libs = warmLibs(state, args.libsPath, args.discovery, err);
+    if (libs == NULL)
+        return 1;
+    return compileOnLibs(state, *libs, args, out, err) ? 0 : 1;
+}
 
+// The builds that run on a pool of this process
+bool buildCtrl(const char *execPath, const CompilerArgs &args)
+{
+    ThreadPool pool(args.options.jobs);
+    if (args.stream)
+        return streamCtrl(args, pool);
+    if (args.batchPath != NULL)
+        return batchCtrl(args, pool);
+    if (args.pipe)
+    {
+        std::vector<std::string> libsPaths;
+        if (args.libsPath != NULL && args.libsPath[0] != '\0')
+            libsPaths.push_back(args.libsPath);
+        return pipeCompile(args.options, args.discovery, pool, libsPaths,
+            std::cin, std::cout, std::cerr);
     }
+    if (args.watch)
+        return watchCtrl(args, pool);
 
-    return true;
+    return compilerCtrl(execPath, args, pool, NULL, std::cout, std::cerr);
 }
 
 int main(int argc, char *argv[])
 {
-    if (argc < 2)
+    CompilerArgs args;
+    if (!parseArgs(argc, argv, args))
         return 1;
 
-    std::string libsPath = "";
-    if (argc >= 3)
+    if (args.connectPath != NULL)
+        return runCompileClient(args.connectPath, argc, argv);
+
+    // counted from here on, the server counts for every request
+    if (args.options.stats)
+        startCountingAllocs();
+
+    if (args.servePath != NULL)
     {
-        libsPath = argv[2];
+        ServerState state(args.options);
+        CompileServer server(args.servePath, [&state](const std::vector<std::string> &reqArgs,
+            const std::string &workDir, std::ostream &out, std::ostream &err)
+        {
+            return serveRequest(state, reqArgs, workDir, out, err);
+        });
+        return server.run() ? 0 : 1;
     }
 
-    if (!compilerCtrl(argv[0], argv[1], argv[2]))
+    if (args.shards > 0)
+        return shardCtrl(args) ? 0 : 1;
+
+    if (args.traceOutPath == NULL)
+        return buildCtrl(argv[0], args) ? 0 : 1;
+
+    startTracing();
+    const bool success = buildCtrl(argv[0], args);
+    // the pool is gone, none of its threads is still recording
+    if (!writeTrace(args.traceOutPath))
     {
+        std::cerr << "ERR: CAN'T WRITE " << args.traceOutPath << '\n';
         return 1;
     }
-
-    return 0;
-}
\ No newline at end of file
+    return success ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+#include <memory>
+#include <sstream>
+
+#include "JackCompilerLib.h"
+#include "CompileDriver.h"
+
+namespace
+{
+
+std::string outputName(const std::string &sourceName)
+{
+    const size_t nameStart = sourceName.find_last_of('/');
+    std::string name = nameStart == std::string::npos ?
+        sourceName : sourceName.substr(nameStart + 1);
+
+    const std::string jackExt = ".jack";
+    if (name.size() > jackExt.size() &&
+        name.compare(name.size() - jackExt.size(), jackExt.size(), jackExt) == 0)
+    {
+        name.resize(name.size() - jackExt.size());
+    }
+    return name;
+}
+
+}
+
+JackCompileResult jackCompile(const jackSourcesMap &sources,
+    const CompilerOptions &options, ThreadPool *pool)
+{
+    std::unique_ptr<ThreadPool> ownPool;
+    if (pool == NULL)
+    {
+        ownPool = std::make_unique<ThreadPool>(options.jobs);
+        pool = ownPool.get();
+    }
+
+    std::vector<SourceUnit> units(sources.size());
+    size_t unitIdx = 0;
+    for (const auto &[sourceName, text] : sources)
+    {
+        units[unitIdx].filePath = sourceName;
+        units[unitIdx].name = outputName(sourceName);
+        units[unitIdx].text = text;
+        ++unitIdx;
+    }
+
+    CompilerContext context(options);
+
+    JackCompileResult result;
+    result.success = compileUnits(context, *pool, units, true);
+
+    for (auto &unit : units)
+    {
+        std::istringstream diagnostics(unit.diagnostics.str());
+        std::string message;
+        while (std::getline(diagnostics, message))
+        {
+            result.diagnostics.push_back({unit.filePath, message});
+        }
+        result.vmCode[unit.name] = std::move(unit.vmCode);
+    }
+    return result;
+}
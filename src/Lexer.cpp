@@ -0,0 +1,512 @@
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#include "Lexer.h"
+#include "Utils.h"
+
+namespace fs = std::filesystem;
+
+void Lexer::setCurFileName(std::string curFilePath)
+{
+    // the name without the directories and the extension,
+    // the paths can be absolute (the server resolves them)
+    curFileName = fs::path(curFilePath).stem().string();
+}
+
+bool Lexer::lexNextLine(std::istream *jackSrc, LexerState &lexState)
+{
+    // the line's buffer is reused
+    if (!std::getline(*jackSrc, curLine))
+    {
+        moreLinesComing = false;
+        return false;
+    }
+    logStrm << curLine << '\n';
+    if (!lexLine(curLine, lexState))
+        return false;
+    if (limits != NULL && !checkLimits(lexState))
+    {
+        moreLinesComing = false;
+        return false;
+    }
+    return true;
+}
+
+bool Lexer::checkLimits(const LexerState &lexState)
+{
+    std::ostringstream hit;
+    if (limits->maxTokens != 0 && lexState.tokens.size() + lexState.tokensDropped > limits->maxTokens)
+        hit << "MORE THAN " << limits->maxTokens << " TOKENS (--max-tokens)";
+    else if (limits->maxNestingDepth != 0 && deepestNesting > limits->maxNestingDepth)
+        hit << "NESTED DEEPER THAN " << limits->maxNestingDepth << " (--max-depth)";
+    else if (std::chrono::steady_clock::now() > deadline)
+        hit << "TOOK LONGER THAN " << limits->maxFileMs << " MS (--max-file-ms)";
+    else
+        return true;
+
+    hit << ", line number: " << lexState.lexedLineIdx;
+    limitHit = hit.str();
+    return false;
+}
+
+void Lexer::initStateBeh(UsefulString &ustr, LexerState &lexState)
+{
+    ustr.skipSpaces();
+    if (ustr.isEol())
+    {
+        lexState.fsmFinished = true;
+        return;
+    }
+
+    char c = ustr.getChar();
+    if (isalpha(c) || c == '_')
+    {
+        ustr.fwd();
+        lexState.addBuff(c);
+        lexState.fsmCurState = LexFsmStates::sLETTERS;
+    }
+    else if (isdigit(c))
+    {
+        ustr.fwd();
+        lexState.addBuff(c);
+        lexState.fsmCurState = LexFsmStates::sDIGITS;
+    }
+    else
+    {
+        // epsilon transition
+        lexState.fsmCurState = LexFsmStates::sSYMBOL;
+    }
+}
+
+void Lexer::lettersStateBeh(UsefulString &ustr, LexerState &lexState)
+{
+    if (ustr.isEol())
+    {
+        lexState.fsmFinished = true;
+        return;
+    }
+
+    char c = ustr.getChar();
+    if (isalpha(c) || c == '_')
+    {
+        ustr.fwd();
+        lexState.addBuff(c);
+        lexState.fsmCurState = LexFsmStates::sLETTERS;
+    }
+    else if (isdigit(c))
+    {
+        ustr.fwd();
+        lexState.addBuff(c);
+        lexState.fsmCurState = LexFsmStates::sDIGITS_AFTER_ALPHA;
+    }
+    else
+    {
+        // epsilon transition
+        lexState.fsmCurState = LexFsmStates::sSYMBOL;
+    }
+}
+
+void Lexer::digitsAfterAlphaStateBeh(UsefulString &ustr, LexerState &lexState)
+{
+    if (ustr.isEol())
+    {
+        lexState.fsmFinished = true;
+        return;
+    }
+
+    char c = ustr.getChar();
+    if (isdigit(c))
+    {
+        ustr.fwd();
+        lexState.addBuff(c);
+        lexState.fsmCurState = LexFsmStates::sDIGITS_AFTER_ALPHA;
+    }
+    else if (isalpha(c) || c == '_')
+    {
+        ustr.fwd();
+        lexState.addBuff(c);
+        lexState.fsmCurState = LexFsmStates::sLETTERS;
+    }
+    else
+    {
+        // epsilon transition
+        lexState.fsmCurState = LexFsmStates::sSYMBOL;
+    }
+}
+
+void Lexer::digitsStateBeh(UsefulString &ustr, LexerState &lexState)
+{
+    if (ustr.isEol())
+    {
+        lexState.fsmFinished = true;
+        return;
+    }
+
+    char c = ustr.getChar();
+    if (isdigit(c))
+    {
+        ustr.fwd();
+        lexState.addBuff(c);
+        lexState.fsmCurState = LexFsmStates::sDIGITS;
+    }
+    else
+    {
+        // epsilon transition
+        lexState.fsmCurState = LexFsmStates::sSYMBOL;
+    }
+}
+
+void Lexer::handleBuffer(LexerState &lexState)
+{
+    const std::string &inBuff = lexState.buffer;
+    tokenMapIter it = tokenLookup.find(inBuff);
+
+    // known keyword
+    if (it != tokenLookup.end())
+    {
+        lexState.tokens.emplace_back(lexState.lexedLineIdx, it->second);
+        return;
+    }
+
+    // a number
+    char * pEnd = NULL;
+    int num = strtol(inBuff.c_str(), &pEnd, 10);
+    if (!*pEnd)
+    {
+        lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tNUMBER, num);
+    }
+    else
+    {
+        const auto identPosNum = vectContains(lexState.identifiers, inBuff);
+        // known identifier
+        if (identPosNum >= 0)
+        {
+            lexState.tokens.emplace_back(lexState.lexedLineIdx, 
+                TokenTypes::tIDENTIFIER, identPosNum);
+        }
+        else
+        {
+            lexState.identifiers.push_back(inBuff);
+            lexState.tokens.emplace_back(lexState.lexedLineIdx, 
+                TokenTypes::tIDENTIFIER, lexState.identifiers.size()-1);
+        }
+    }
+    // Only considered a term (alhpanumeric)
+    // if we are on the right handside.
+    // TODO: see if can be moved too Parser,
+    // otherwise we are bringing semantics
+    // to syntactic analyzer.
+    if (lexState.onRhs)
+        lexState.lastOperTermIsOper = false;
+}
+
+void Lexer::symbolStateBeh(UsefulString &ustr, LexerState &lexState)
+{
+    if (!lexState.buffEmpty())
+    {
+        handleBuffer(lexState);
+        lexState.flush();
+    }
+
+    ustr.skipSpaces();
+    if (ustr.isEol())
+    {
+        lexState.fsmFinished = true;
+        return;
+    }
+
+    char c = ustr.getChar();
+    if (isalpha(c) || c == '_' || isdigit(c))
+    {
+        // epsilon transition
+        lexState.fsmCurState = LexFsmStates::sINIT;
+        return;
+    }
+
+    if (c == '/')
+    {
+        ustr.fwd();
+        if (ustr.getChar() == '/')
+        {
+            lexState.fsmCurState = LexFsmStates::sCOMMENT;
+            return;
+        }
+        ustr.bwd();
+    }
+
+    std::string s(1, c);
+    tokenMapIter it = tokenLookup.find(s);
+    if (it != tokenLookup.end())
+    {   
+        // only updating if on the right hand side
+        if (lexState.onRhs)
+        {
+            if (it->first[0] == ')')
+                lexState.lastOperTermIsOper = false;
+            // a hack to treat - as negation and not subtraction after ','
+            // e.g. calc(14, -a);
+            else if (it->first[0] == ',')
+                lexState.lastOperTermIsOper = true;
+        }
+
+        // can't happen when the above triggered
+        // so the order doesn't matter
+        if (it->second == TokenTypes::tEQUAL 
+            // expr/term start withing ()
+            // e.g. calc(-25)
+            || it->second == TokenTypes::tLPR)
+        {
+            lexState.onRhs = true;
+        }
+
+        if (it->second == TokenTypes::tLPR || it->second == TokenTypes::tLBR
+            || it->second == TokenTypes::tLCURL)
+        {
+            // a depth over the limit stops the lexing
+            // once the line is done
+            deepestNesting = std::max(deepestNesting, ++nestingDepth);
+        }
+        else if ((it->second == TokenTypes::tRPR || it->second == TokenTypes::tRBR
+            || it->second == TokenTypes::tRCURL) && nestingDepth > 0)
+        {
+            --nestingDepth;
+        }
+
+        if (it->second == TokenTypes::tMINUS)
+        {
+            if (lexState.lastOperTermIsOper)
+                lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tNEG_MINUS);
+            else
+            {
+                lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tMINUS);
+                lexState.lastOperTermIsOper = true;
+            }
+        }
+        else
+        {
+            lexState.tokens.emplace_back(lexState.lexedLineIdx, it->second);
+            if (isbinaryperator(it->second))
+                lexState.lastOperTermIsOper = true;
+        }   
+    }
+    else
+    {
+        lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tUNKNOWN_SYMBOL);
+    }
+
+    ustr.fwd();
+    // epsilon transition
+    lexState.fsmCurState = LexFsmStates::sSYMBOL;
+}
+
+void Lexer::commentStateBeh(UsefulString &ustr, LexerState &lexState)
+{
+    if (ustr.isEol())
+    {
+        lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tDIV);
+        lexState.fsmFinished = true;
+        return;
+    }
+    
+    char c = ustr.getChar();
+    // no more tokens on this line, finishing
+    if (c == '/')
+    {
+        lexState.commentOpen = true;
+        lexState.fsmFinished = true;
+    }
+    else if (c == '*')
+    {
+        lexState.commentOpen = true;
+        lexState.mlineComment = true;
+
+        ustr.fwd();
+        lexState.fsmCurState = LexFsmStates::sMLINE_COMMENT;
+    }
+    else
+    {
+        lexState.tokens.emplace_back(lexState.lexedLineIdx, TokenTypes::tDIV);
+
+        ustr.fwd();
+        lexState.fsmCurState = LexFsmStates::sSYMBOL;
+    }
+}
+
+void Lexer::mlineCommentStateBeh(UsefulString &ustr, LexerState &lexState)
+{
+    if (ustr.isEol())
+    {
+        lexState.fsmFinished = true;
+        return;
+    }
+
+    char c = ustr.getChar();
+    logStrm << c << '\n';
+    
+    bool commentClosed = false;
+    do
+    {
+        logStrm << "Enter fwd?\n";
+        c = ustr.getChar();
+        if (c == '*')
+        {
+            if (!ustr.fwd())
+                break;
+            c = ustr.getChar();
+            // comment end
+            if (c == '/')
+            {
+                commentClosed = true;
+                break;
+            }
+        }
+    } while (ustr.fwd());
+
+    if (commentClosed)
+    {
+        lexState.commentOpen = false;
+        lexState.mlineComment = false;
+        
+        ustr.fwd();
+        lexState.fsmCurState = LexFsmStates::sINIT;
+    }
+}
+
+bool Lexer::lexLine(const std::string &line, LexerState &lexState)
+{
+    UsefulString ustr(line);
+
+    std::stringstream debug_strm;
+    while (!lexState.fsmFinished)
+    {
+        debug_strm.str(std::string());
+        switch (lexState.fsmCurState)
+        {
+        case LexFsmStates::sINIT:
+            debug_strm << "sINIT hits\n";
+            initStateBeh(ustr, lexState);
+            break;
+
+        case LexFsmStates::sLETTERS:
+            debug_strm << "sLETTERS hits\n";
+            lettersStateBeh(ustr, lexState);
+            break;
+
+        case LexFsmStates::sDIGITS_AFTER_ALPHA:
+            debug_strm << "sDIGITS_AFTER_ALPHA hits\n";
+            digitsAfterAlphaStateBeh(ustr, lexState);
+            break;
+
+        case LexFsmStates::sDIGITS:
+            debug_strm << "sDIGITS hits\n";
+            digitsStateBeh(ustr, lexState);
+            break;
+
+        case LexFsmStates::sSYMBOL:
+            debug_strm << "sSYMBOL hits\n";
+            symbolStateBeh(ustr, lexState);
+            break;
+
+        case LexFsmStates::sCOMMENT:
+            debug_strm << "sCOMMENT hits\n";
+            commentStateBeh(ustr, lexState);
+            break;
+
+        case LexFsmStates::sMLINE_COMMENT:
+            debug_strm << "sMLINE_COMMENT hits\n";
+            mlineCommentStateBeh(ustr, lexState);
+            break;
+        }
+#ifdef LEXER_DEBUG
+        std::cout << debug_strm.str();
+#endif
+    }
+
+    if (!lexState.buffEmpty())
+    {
+        handleBuffer(lexState);
+    }
+
+    lexState.lexedLineIdx++;
+
+#ifdef LEXER_DEBUG
+    std::cout << "Finished tokenizing line: " << line << '\n';
+    std::cout << "Got this many tokens now: " << lexState.tokens.size() << '\n';
+#endif
+    return true;
+}
+
+bool tokenize(std::istream &jackSrc, Lexer &lexer, LexerState &lexState)
+{
+    #ifdef LEXER_DEBUG
+    auto printTokens = [](const tokensVect &tokens)
+    {
+        for (auto elem : tokens)
+        {
+            std::cout << "Token type: "  << tType_to_string(elem.tType) << '\n';
+            if (elem.tVal.has_value())    
+                std::cout << "Token val: " << elem.tVal.value() << '\n';
+            else
+                std::cout << "Token val: none\n";
+        }
+        std::cout << '\n';
+    };
+#endif
+    auto printIdentifiers = [](const identifierVect &identifiers)
+    {
+        int i = 0;
+        for (auto elem : identifiers)
+        {
+            std::cout << "Identifier idx: "  << i << '\n';
+            std::cout << "Identifier val: "  << elem << '\n';            
+            i++;
+        }
+        std::cout << '\n';
+    };
+
+    while (lexer.getMoreLinesComing())
+    {
+        const bool res = lexer.lexNextLine(&jackSrc, lexState);
+        // parsing of the current line failed
+        if (!res)
+        {
+            lexState.reset();
+            continue;
+        }
+
+#ifdef LEXER_DEBUG
+        printTokens(lexState.tokens);
+        printIdentifiers(lexState.identifiers);
+#endif
+
+        lexState.reset();
+    }
+
+    return lexer.getLimitHit().empty();
+}
+
+bool tokenize(const std::string &filePath, Lexer &lexer, LexerState &lexState)
+{
+    std::ifstream jackFile;
+    jackFile.open(filePath, std::ios::in);
+    if (!jackFile)
+        return false;
+
+    lexer.log() << filePath << '\n';
+    lexer.setCurFileName(filePath);
+
+    return tokenize(jackFile, lexer, lexState);
+}
+
+bool tokenize(const std::string &filePath, const std::string &text, Lexer &lexer, LexerState &lexState)
+{
+    lexer.log() << filePath << '\n';
+    lexer.setCurFileName(filePath);
+
+    std::istringstream jackSrc(text);
+    return tokenize(jackSrc, lexer, lexState);
+}
@@ -1,21 +1,22 @@
 #include "LexerTypes.h"
 
+void LexerState::releaseTokens()
+{
+    tokensVect().swap(tokens);
+}
+
 void LexerState::flush()
 {
-    buffer[0] = '\0';
-    bIdx = 0;
+    buffer.clear();
 }
-bool LexerState::addBuff(char c)
+void LexerState::addBuff(char c)
 {
-    if (bIdx >= 20)
-        return false;
-    buffer[bIdx++] = c;
-    return true;
+    buffer.push_back(c);
 }
 
 bool LexerState::buffEmpty()
 {
-    return buffer[0] == '\0' || bIdx == 0;
+    return buffer.empty();
 }
 
 void LexerState::reset()
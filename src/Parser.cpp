@@ -1,7 +1,7 @@
 #include "Parser.h"
 
 // HELPER MACROS
-#define ALLOC_AST_NODE new (aralloc.allocate()) AstNode
+#define ALLOC_AST_NODE newAstNode
 
 inline AstNode *Parser::createStackTopNode(ParserState &pState, TokenData &token)
 {
@@ -81,7 +81,8 @@ void Parser::orderElseLabels(AstNode *elseNode)
 bool Parser::parseFuncPars(ParserState &pState)
 {
     auto *token = &(pState.getCurToken());
-    assert(token->tType == TokenTypes::tLPR);
+    if (token->tType != TokenTypes::tLPR)
+        return syntaxError("(");
     assert(pState.getCurParseFunc() != NULL);
 
     bool success = false;
@@ -102,7 +103,7 @@ bool Parser::parseFuncPars(ParserState &pState)
         }
 
         if (!isvartype(token->tType))
-            return pState.fsmTerminate(false);
+            return syntaxError("PARAMETER TYPE");
         LangDataTypes curParValType = tType_to_ldType(token->tType);
         if (curParValType == LangDataTypes::ldCLASS)
         {
@@ -115,8 +116,8 @@ bool Parser::parseFuncPars(ParserState &pState)
         {
             return pState.fsmTerminate(false);
         }
-        assert(token->tType == TokenTypes::tIDENTIFIER);
-        assert(token->tVal.has_value());
+        if (token->tType != TokenTypes::tIDENTIFIER)
+            return syntaxError("PARAMETER NAME");
         pState.addCurParseFuncPar(token->tVal.value(), curParValType);
 
         // comma or function decl closing bracket
@@ -131,13 +132,121 @@ bool Parser::parseFuncPars(ParserState &pState)
             break;
         }
         else if (token->tType != TokenTypes::tCOMMA)
-            return pState.fsmTerminate(false);
+            return syntaxError(", OR )");
     }
 
     return 
         success ? true : pState.fsmTerminate(false);
 }
 
+bool Parser::skipFuncBody(ParserState &pState)
+{
+    if (pState.getFsmFinished())
+        return false;
+
+    // from the ) closing the parameters to the {
+    if (!pState.advance() || pState.getCurToken().tType != TokenTypes::tLCURL)
+        return pState.fsmTerminate(false);
+
+    unsigned int depth = 1;
+    while (depth > 0)
+    {
+        if (!pState.advance())
+            return pState.fsmTerminate(false);
+
+        const auto tType = pState.getCurToken().tType;
+        if (tType == TokenTypes::tLCURL)
+            depth++;
+        else if (tType == TokenTypes::tRCURL)
+            depth--;
+    }
+
+    // the } of the class comes at the latest
+    if (!pState.advance())
+        return pState.fsmTerminate(false);
+
+    pState.fsmCurState = ParseFsmStates::sCLASS_DECIDE;
+    return true;
+}
+
+// Nodes which have to keep their children after those were emitted,
+// because the label fix-ups read them later (e.g. else reads IF_JUMP of its if).
+// Children of the rest (statements, class, root) are dropped.
+static bool keepsEmittedChildren(AstNodeTypes aType)
+{
+    return isblockstart(aType) && aType != AstNodeTypes::aCLASS;
+}
+
+// past the last of the subtree's nodes in the arena
+static size_t subtreeEnd(const AstNode *node, const ArenaAllocator<AstNode> &aralloc)
+{
+    size_t end = aralloc.indexOf(node) + 1;
+    for (const auto *childNode : node->nChildNodes)
+    {
+        end = std::max(end, subtreeEnd(childNode, aralloc));
+    }
+    return end;
+}
+
+void Parser::emitFinishedNodes()
+{
+    // everything on the path from the root to the stack top
+    // is still open, everything to the left of it is finished
+    openPath.clear();
+    for (auto *node = pState.getStackTop(); node != NULL; node = node->getParent())
+    {
+        openPath.push_back(node);
+    }
+
+    for (auto it = openPath.rbegin(); it != openPath.rend(); ++it)
+    {
+        AstNode *openChild = (it + 1 != openPath.rend()) ? *(it + 1) : NULL;
+        emitFinishedChildren(*it, openChild);
+    }
+}
+
+void Parser::emitFinishedChildren(AstNode *node, AstNode *openChild)
+{
+    auto &children = node->nChildNodes;
+    while (node->nEmittedChildren < children.size() 
+        && children[node->nEmittedChildren] != openChild)
+    {
+        directGen->generatePending(children[node->nEmittedChildren]);
+        node->nEmittedChildren++;
+    }
+
+    if (keepsEmittedChildren(node->aType) || node->nEmittedChildren == 0)
+        return;
+
+    // a finished function is the last thing allocated in the arena
+    // but for the tree still open, which has to outlive it
+    AstNode *firstFuncNode = NULL;
+    for (unsigned int i = 0; i < node->nEmittedChildren; ++i)
+    {
+        if (children[i]->aType == AstNodeTypes::aFUNCTION)
+        {
+            firstFuncNode = children[i];
+            break;
+        }
+    }
+
+    children.erase(children.begin(), children.begin() + node->nEmittedChildren);
+    node->nEmittedChildren = 0;
+
+    if (firstFuncNode == NULL)
+        return;
+    // everything still in the tree, from its root on
+    const size_t liveEnd = subtreeEnd(openPath.back(), aralloc);
+    aralloc.releaseFrom(std::max(aralloc.indexOf(firstFuncNode), liveEnd));
+}
+
+void Parser::feedTokens()
+{
+    unsigned int curTokenId = pState.getCurTokenID();
+    (*tokenFeed)(*pState.getTokens(), curTokenId, pState.fsmCurState == ParseFsmStates::sINIT);
+    pState.setCurTokenID(curTokenId);
+}
+
 void Parser::loadArrSysClass(unsigned int arrayLib_className_id)
 {
     unsigned int classID = 0;    
@@ -165,13 +274,21 @@ bool Parser::initStateBeh(ParserState &pState)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
 
-    assert(token->tType == TokenTypes::tIDENTIFIER);
-    assert(token->tVal.has_value());
+    if (token->tType != TokenTypes::tIDENTIFIER)
+        return syntaxError("CLASS NAME");
     auto classNameID = token->tVal.value();
     auto [classExists, idx] = pState.containsClass(classNameID);
     if (classExists)
     {
-        assert(pState.getClassByID(idx).getIsDefined() == false);
+        // the bodies pass comes back to the classes
+        // that the signature pass has defined
+        if (pState.getClassByID(idx).getIsDefined() &&
+            pState.getParsePass() == ParsePasses::ppSIGNATURES)
+        {
+            pState.err() << "ERR: CLASS REDEFINITION: " << pState.getIdent()->at(classNameID) <<
+                ", line number: " << token->debug_lineNum + 1 << '\n';
+            return pState.fsmTerminate(false);
+        }
         pState.setCurParseClass(idx);
     }
     else 
@@ -181,10 +298,14 @@ bool Parser::initStateBeh(ParserState &pState)
     }
 
     auto *classNode = createStackTopNode(pState, AstNodeTypes::aCLASS, pState.getCurParseClass()->getID());
+    traceParserBegin("class", (*pState.getIdent())[classNameID]);
 
+    if (!pState.advance())
+        return pState.fsmTerminate(false);
+    if (pState.getCurToken().tType != TokenTypes::tLCURL)
+        return syntaxError("{");
     // skipping the {
-    pState.advanceAndGet(2);
-    if (pState.getTokensFinished())
+    if (!pState.advance())
         return pState.fsmTerminate(false);
 
     pState.fsmCurState = ParseFsmStates::sCLASS_DECIDE;
@@ -219,7 +340,7 @@ void Parser::statementDecideStateBeh(ParserState &pState)
             break;
         default:
 #ifdef ERR_DEBUG
-            std::cerr << "ERR: UNKNOWN sSTATEMENT_DECIDE outgoing state: " << (unsigned int)token.tType << '\n';
+            pState.err() << "ERR: UNKNOWN sSTATEMENT_DECIDE outgoing state: " << (unsigned int)token.tType << '\n';
 #endif
             pState.fsmTerminate(false);
             break;
@@ -251,7 +372,7 @@ void Parser::classDecideStateBeh(ParserState &pState)
             break;
         default:
 #ifdef ERR_DEBUG
-            std::cerr << "ERR: UNKNOWN sCLASS_DECIDE outgoing state: " << (unsigned int)token.tType << '\n';
+            pState.err() << "ERR: UNKNOWN sCLASS_DECIDE outgoing state: " << (unsigned int)token.tType << '\n';
 #endif
             pState.fsmTerminate(false);
             break;
@@ -282,18 +403,22 @@ bool Parser::fieldAndStaticStateBeh(ParserState &pState, bool isStatic)
         auto &varToken = pState.advanceAndGet();
         if (pState.getTokensFinished())
             return pState.fsmTerminate(false);
+        if (varToken.tType != TokenTypes::tIDENTIFIER)
+            return syntaxError("VARIABLE NAME");
 
         unsigned int nameID = varToken.tVal.value();
-        if (std::get<0>(pState.containsField(varToken.tVal.value())) ||
-            std::get<0>(pState.containsStatic(varToken.tVal.value())))
+        // the bodies pass knows them from the signature pass
+        const bool declaring = pState.getParsePass() == ParsePasses::ppSIGNATURES;
+        if (declaring && (std::get<0>(pState.containsField(varToken.tVal.value())) ||
+            std::get<0>(pState.containsStatic(varToken.tVal.value()))))
         {
 #ifdef ERR_DEBUG
             assert (nameID < pState.getIdent()->size());
-            std::cerr << "ERR: VARIABLE REDECLARATION: " << pState.getIdent()->at(nameID) << '\n';
+            pState.err() << "ERR: VARIABLE REDECLARATION: " << pState.getIdent()->at(nameID) << '\n';
 #endif
             // TODO: error: variable redeclaration
         }
-        else
+        else if (declaring)
         {
             if (isStatic)
                 pState.addCurParseClassStaticVar(nameID, tType_to_ldType(valTypeToken.tType));
@@ -316,6 +441,7 @@ bool Parser::fieldAndStaticStateBeh(ParserState &pState, bool isStatic)
 
 bool Parser::ctorDefStateBeh(ParserState &pState)
 {
+    const unsigned int defTokenId = pState.getCurTokenID();
     // token is constructor at this point
     // advancing to return type
     auto *token = &(pState.advanceAndGet());
@@ -352,8 +478,8 @@ bool Parser::ctorDefStateBeh(ParserState &pState)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
 
-    assert(token->tType == TokenTypes::tIDENTIFIER);
-    assert(token->tVal.has_value());
+    if (token->tType != TokenTypes::tIDENTIFIER)
+        return syntaxError("CONSTRUCTOR NAME");
 
     // NOTE: this is needed to not do obj.constructor
     // see twin-note in ParserTypes::findVariable
@@ -367,8 +493,14 @@ bool Parser::ctorDefStateBeh(ParserState &pState)
     
     // advancing to (
     pState.advance();
-    parseFuncPars(pState);
+    if (!parseFuncPars(pState))
+        return false;
+
+    if (pState.getParsePass() == ParsePasses::ppSIGNATURES)
+        return skipFuncBody(pState);
 
+    funcStartTokenId = defTokenId;
+    funcCallees = FuncCodeCache::Key();
     // skipping the {
     if (!pState.advance(2))
         return pState.fsmTerminate(false);
@@ -377,6 +509,7 @@ bool Parser::ctorDefStateBeh(ParserState &pState)
     auto *ctorNode = createStackTopNode(pState, AstNodeTypes::aFUNCTION, ctorFunc.getID());
 
     std::string fullCtorName = craftFullFuncName(pState, *(pState.getCurParseClass()), ctorFunc);
+    traceParserBegin("function", fullCtorName);
     ctorNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aFUNC_DEF, fullCtorName));
     ctorNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aFUNC_LOCNUM, 0));
 
@@ -395,6 +528,7 @@ bool Parser::ctorDefStateBeh(ParserState &pState)
 
 bool Parser::funcDefStateBeh(ParserState &pState, bool isMethod)
 {
+    const unsigned int defTokenId = pState.getCurTokenID();
     // token is function at this point
     // advancing to return type
     auto *token = &(pState.advanceAndGet());
@@ -414,21 +548,31 @@ bool Parser::funcDefStateBeh(ParserState &pState, bool isMethod)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
 
-    assert(token->tType == TokenTypes::tIDENTIFIER);
-    assert(token->tVal.has_value());
+    if (token->tType != TokenTypes::tIDENTIFIER)
+        return syntaxError("SUBROUTINE NAME");
 
-    pState.addCurParseClassFunc(token->tVal.value(), ldType_ret, isMethod);
+    if (!pState.addCurParseClassFunc(token->tVal.value(), ldType_ret, isMethod))
+    {
+        // TODO: error: function not matching the signature pass
+        return pState.fsmTerminate(false);
+    }
     // advancing to (
     pState.advance();
 
     if (isMethod)
     {   
         assert(pState.getCurParseFunc() != NULL);
-        pState.getCurParseFunc()->addPar(thisNameID, 
+        pState.addCurParseFuncPar(thisNameID, 
             pState.getCurParseClass()->asLangDataType());
     }
-    parseFuncPars(pState);
+    if (!parseFuncPars(pState))
+        return false;
+
+    if (pState.getParsePass() == ParsePasses::ppSIGNATURES)
+        return skipFuncBody(pState);
 
+    funcStartTokenId = defTokenId;
+    funcCallees = FuncCodeCache::Key();
     // skipping the {
     if (!pState.advance(2))
         return pState.fsmTerminate(false);
@@ -437,6 +581,7 @@ bool Parser::funcDefStateBeh(ParserState &pState, bool isMethod)
     auto *funcNode = createStackTopNode(pState, AstNodeTypes::aFUNCTION, curParseFunc.getID());
 
     std::string fullFuncName = craftFullFuncName(pState, *(pState.getCurParseClass()), curParseFunc);
+    traceParserBegin("function", fullFuncName);
     funcNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aFUNC_DEF, fullFuncName));
     funcNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aFUNC_LOCNUM, 0));
 
@@ -484,12 +629,14 @@ bool Parser::funcDoCallStateBeh(ParserState &pState)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
     
-    assert (funcToken.tType == TokenTypes::tIDENTIFIER);
-    assert (funcToken.tVal.has_value());
+    if (funcToken.tType != TokenTypes::tIDENTIFIER)
+        return syntaxError("SUBROUTINE CALL");
 
-    AstNode* funcRootNode;
+    AstNode* funcRootNode = NULL;
     const bool allowVariable = false;
-    processIdentifier(funcToken, funcRootNode, allowVariable);
+    // what is wrong with the call has been reported
+    if (!processIdentifier(funcToken, funcRootNode, allowVariable) || funcRootNode == NULL)
+        return pState.fsmTerminate(false);
     pState.addStackTopChild(funcRootNode);
 
     if (pState.getCurToken().tType != TokenTypes::tRPR)
@@ -548,13 +695,15 @@ std::tuple<bool, AstNode*> Parser::parseFuncCallArgs(ParserState &pState, int cl
         }
     }
 
-    // checking that we designed the processing correctly
-    // hence assert
-    assert(pState.getCurToken().tType == TokenTypes::tRPR || 
-        pState.getCurToken().tType == TokenTypes::tSEMICOLON);
+    if (pState.getFsmFinished())
+        return {false, NULL};
+    if (pState.getCurToken().tType != TokenTypes::tRPR &&
+        pState.getCurToken().tType != TokenTypes::tSEMICOLON)
+        return {syntaxError(")"), NULL};
 
     auto *stackTop = pState.getStackTop();
-    assert(stackTop->aType == AstNodeTypes::aDO);
+    if (stackTop == NULL || stackTop->aType != AstNodeTypes::aDO)
+        return {syntaxError(")"), NULL};
     const unsigned int numArgs = stackTop->getNumOfChildren();
 
     std::string fullFuncName = craftFullFuncName(pState, pState.getClassByID(classID), nameID);
@@ -568,6 +717,13 @@ std::tuple<bool, AstNode*> Parser::handleFuncNodes(TokenData &token, FuncMethodD
 {
     // legowelt TODO: makes sense to have checkcreateFunction instead of findFunction
     auto [contains, funcID] = pState.findFunction(token.tVal.value(), classID);
+    // every call the body makes is recorded, the build records
+    // keep the ones into the classes of other files (see generateUnits)
+    if (classID >= 0 && pState.getParsePass() == ParsePasses::ppBODIES)
+        pState.addUsedFunc(pState.getClassByID(classID).nameID, token.tVal.value());
+    if (funcKeysKept)
+        addFuncCallee(classID, token.tVal.value(), contains, funcID);
+
     if (contains)
     {
         pState.addStackTop(ALLOC_AST_NODE(AstNodeTypes::aDO));
@@ -625,7 +781,7 @@ bool Parser::parseFuncCall(int classID, FuncMethodData &funcMethodData, AstNode
         {
             // TODO: error: UNKNOWN IDENTIFIER
         #ifdef ERR_DEBUG
-            std::cerr << "ERR: UNKNOWN 2 IDENTIFIER: " << pState.getIdent()->at(token->tVal.value()) << '\n';
+            pState.err() << "ERR: UNKNOWN 2 IDENTIFIER: " << pState.getIdent()->at(token->tVal.value()) << '\n';
         #endif
         }
         else
@@ -638,7 +794,7 @@ bool Parser::parseFuncCall(int classID, FuncMethodData &funcMethodData, AstNode
     else
     {
     #ifdef ERR_DEBUG
-        std::cerr << "ERR: EXPECTED IDENTIFIER, BUT FOUND: " << tType_to_string(token->tType) << '\n';
+        pState.err() << "ERR: EXPECTED IDENTIFIER, BUT FOUND: " << tType_to_string(token->tType) << '\n';
     #endif
         continueParsing = true;
     }
@@ -662,7 +818,7 @@ bool Parser::processIdentifier(TokenData &identToken, AstNode *&resNode, bool al
             if (!allowVariable)
             {
 #ifdef ERR_DEBUG
-                std::cerr << "ERR: VARIABLE NOT ALLOWED HERE, line number: " << 
+                pState.err() << "ERR: VARIABLE NOT ALLOWED HERE, line number: " << 
                     ", line number: " << identToken.debug_lineNum << '\n';
 #endif
                 // TODO: error: variable not allowed here
@@ -737,7 +893,7 @@ bool Parser::processIdentifier(TokenData &identToken, AstNode *&resNode, bool al
                 if (!success)
                 {
             #ifdef ERR_DEBUG
-                std::cerr << "ERR: UNKNOWN 3 IDENTIFIER: " << pState.getIdent()->at(identToken.tVal.value()) << '\n';
+                pState.err() << "ERR: UNKNOWN 3 IDENTIFIER: " << pState.getIdent()->at(identToken.tVal.value()) << '\n';
             #endif
                 }
 
@@ -754,6 +910,10 @@ AstNode *Parser::parseExpr(ParserState &pState)
     // checking if expr is finished
     while (true)
     {   
+        // stopped by a nested call, or out of tokens
+        if (pState.getFsmFinished())
+            return NULL;
+
         auto &token = pState.getCurToken();
         // we hit the right bracket of while/if or the statement has ended with ;
         if ((pState.getLayer() == 0 && token.tType == TokenTypes::tRPR)
@@ -798,9 +958,20 @@ AstNode *Parser::parseExpr(ParserState &pState)
         }
         else if (isbinaryperator(token.tType))
         {
+            // ~ has no precedence, the expressions don't support it
+            if (precedLookup.find(token.tType) == precedLookup.end())
+            {
+                syntaxError("BINARY OPERATOR");
+                return NULL;
+            }
             // stack top (potentially operator)
             auto *stackTop = pState.getStackTop();
-            assert(stackTop != NULL);
+            // nothing for the operator to work on
+            if (stackTop == NULL || curTermNode == NULL)
+            {
+                syntaxError("OPERAND");
+                return NULL;
+            }
             // current token (operator) as AST node
             // commin for the following two cases and needed for greaterPreced,\
             // so carried placed here
@@ -847,6 +1018,12 @@ AstNode *Parser::parseExpr(ParserState &pState)
         // array
         else if (token.tType == TokenTypes::tLBR)
         {
+            // a [ not after an array
+            if (curTermNode == NULL)
+            {
+                syntaxError("OPERAND");
+                return NULL;
+            }
             pState.incArrayEnteryNum();
             auto *arrayNode = ALLOC_AST_NODE(AstNodeTypes::aARRAY);
             pState.addStackTop(arrayNode);
@@ -877,8 +1054,16 @@ AstNode *Parser::parseExpr(ParserState &pState)
             do 
             {
                 stackTop = pState.getStackTop();
-                assert(stackTop != NULL);
-                stackTop->addChildConditional(curTermNode);
+                // a ] without its [
+                if (stackTop == NULL || (!isoperator(aType_to_tType(stackTop->aType)) &&
+                    stackTop->aType != AstNodeTypes::aARRAY))
+                {
+                    syntaxError("EXPRESSION");
+                    return NULL;
+                }
+                // NULL after an unknown identifier, reported already
+                if (curTermNode != NULL)
+                    stackTop->addChildConditional(curTermNode);
                 curTermNode = stackTop;
                 pState.popStackTop();
             }
@@ -902,19 +1087,20 @@ AstNode *Parser::parseExpr(ParserState &pState)
         }
         else
         {
-            // some TokenTypes entry hasn't been covered by parser
-#ifdef ERR_DEBUG   
-            std::cerr << "ERR: TOKEN TYPE NOT COVERED IN PARSER: " << tType_to_string(token.tType) <<
-            ", line number: " << token.debug_lineNum << '\n';
-#endif
-            assert(false);
+            // not something an expression has
+            syntaxError("EXPRESSION");
+            return NULL;
         }
 
         pState.advance();
     }
 
     auto *stackTop = pState.getStackTop();
-    assert(stackTop != NULL);
+    if (stackTop == NULL)
+    {
+        syntaxError("STATEMENT");
+        return NULL;
+    }
     
     if (curTermNode != NULL)
         stackTop->addChildConditional(curTermNode);
@@ -926,7 +1112,11 @@ AstNode *Parser::parseExpr(ParserState &pState)
         auto *lastStackTop = stackTop;
         pState.popStackTop();
         stackTop = pState.getStackTop();
-        assert(stackTop != NULL);
+        if (stackTop == NULL)
+        {
+            syntaxError("STATEMENT");
+            return NULL;
+        }
         stackTop->addChild(lastStackTop);
     }
 
@@ -943,7 +1133,7 @@ bool Parser::whileStateBeh(ParserState &pState)
     // we will jump to the lable generated by this node
     // in the resulting code
     auto *whileStartNode = ALLOC_AST_NODE(AstNodeTypes::aWHILE_START);
-    whileStartNode->setNodeValue(getLabelId());
+    whileStartNode->setNodeValue(pState.nextLabelId());
     whileNode->addChild(whileStartNode);
 
     auto &token = pState.advanceAndGet();
@@ -951,15 +1141,20 @@ bool Parser::whileStateBeh(ParserState &pState)
         return pState.fsmTerminate(false);
 
     if (token.tType != TokenTypes::tLPR)
-        return false; // TODO: error
+        return syntaxError("(");
 
     if (!pState.advance())
         return pState.fsmTerminate(false);
 
     parseExpr(pState);
+    if (pState.getFsmFinished())
+        return false;
+    // the condition
+    if (whileNode->getNumOfChildren() != 2)
+        return syntaxError("CONDITION");
 
     whileNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aWHILE_JUMP));
-    whileNode->nChildNodes.back()->setNodeValue(getLabelId());
+    whileNode->nChildNodes.back()->setNodeValue(pState.nextLabelId());
     
     whileNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aSTATEMENTS));
 
@@ -974,12 +1169,11 @@ bool Parser::whileStateBeh(ParserState &pState)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
 
-    if (lcurltoken.tType == TokenTypes::tLCURL)
-    {
-        if (!pState.advance())
-            return pState.fsmTerminate(false);
-    }
-    // else error
+    if (lcurltoken.tType != TokenTypes::tLCURL)
+        return syntaxError("{");
+    if (!pState.advance())
+        return pState.fsmTerminate(false);
+
     pState.fsmCurState = ParseFsmStates::sSTATEMENT_DECIDE;
     return true;
 }
@@ -994,17 +1188,22 @@ bool Parser::ifStateBeh(ParserState &pState)
         return pState.fsmTerminate(false);
 
     if (token.tType != TokenTypes::tLPR)
-        return false; // TODO: error
+        return syntaxError("(");
 
     if (!pState.advance())
         return pState.fsmTerminate(false);
 
     parseExpr(pState);
+    if (pState.getFsmFinished())
+        return false;
+    // the condition
+    if (ifNode->getNumOfChildren() != 1)
+        return syntaxError("CONDITION");
 
     ifNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aNEG_MINUS));
 
     ifNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aIF_JUMP));
-    ifNode->nChildNodes.back()->setNodeValue(getLabelId());
+    ifNode->nChildNodes.back()->setNodeValue(pState.nextLabelId());
 
     ifNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aSTATEMENTS));
     pState.addStackTop(ifNode->nChildNodes.back());
@@ -1013,15 +1212,13 @@ bool Parser::ifStateBeh(ParserState &pState)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
         
-    if (lcurltoken.tType == TokenTypes::tLCURL)
-    {
-        if (!pState.advance())
-            return pState.fsmTerminate(false);
-    }
+    if (lcurltoken.tType != TokenTypes::tLCURL)
+        return syntaxError("{");
+    if (!pState.advance())
+        return pState.fsmTerminate(false);
 
     orderIfLables(ifNode);
 
-    // else error
     pState.fsmCurState = ParseFsmStates::sSTATEMENT_DECIDE;
     return true;
 }
@@ -1032,7 +1229,7 @@ bool Parser::elseStateBeh(ParserState &pState)
     auto *elseNode = createStackTopNode(pState, elseToken);
 
     elseNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aELSE_JUMP));
-    elseNode->nChildNodes.back()->setNodeValue(getLabelId());
+    elseNode->nChildNodes.back()->setNodeValue(pState.nextLabelId());
 
     elseNode->addChild(ALLOC_AST_NODE(AstNodeTypes::aELSE_START));
     // getNodeValue() will be set in orderElseLabels
@@ -1045,15 +1242,13 @@ bool Parser::elseStateBeh(ParserState &pState)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
         
-    if (lcurltoken.tType == TokenTypes::tLCURL)
-    {
-        if (!pState.advance())
-            return pState.fsmTerminate(false);
-    }
+    if (lcurltoken.tType != TokenTypes::tLCURL)
+        return syntaxError("{");
+    if (!pState.advance())
+        return pState.fsmTerminate(false);
 
     orderElseLabels(elseNode);
 
-    // else error
     pState.fsmCurState = ParseFsmStates::sSTATEMENT_DECIDE;
     return true;
 }
@@ -1083,6 +1278,17 @@ void Parser::blockCloseStateBeh(ParserState &pState)
     auto popUntilBlockParent = [&] ()
     {
         popUntilBlockStart();
+        // the functions' and the classes' trace events end with them
+        const auto *blockStart = pState.getStackTop();
+        if (blockStart != NULL && (blockStart->aType == AstNodeTypes::aFUNCTION ||
+            blockStart->aType == AstNodeTypes::aCLASS))
+            traceParserEnd();
+        if (blockStart != NULL && blockStart->aType == AstNodeTypes::aFUNCTION)
+        {
+            if (funcKeysKept)
+                addFuncKey(blockStart);
+            pState.closeCurParseFuncLocals();
+        }
         // popping the actual block start
         pState.popStackTop();
     };
@@ -1106,8 +1312,11 @@ void Parser::blockCloseStateBeh(ParserState &pState)
     {
         popUntilBlockStart();
         auto *ifNode = pState.getStackTop();
-
-        assert(ifNode->aType == AstNodeTypes::aIF);
+        if (ifNode == NULL || ifNode->aType != AstNodeTypes::aIF)
+        {
+            syntaxError("STATEMENT");
+            return;
+        }
         // else node will do the label generation now
         ifNode->generatesCode = false;
 
@@ -1117,6 +1326,12 @@ void Parser::blockCloseStateBeh(ParserState &pState)
     }
 
     popUntilBlockParent();
+    // a } with nothing open
+    if (pState.getStackTop() == NULL)
+    {
+        syntaxError("END OF FILE");
+        return;
+    }
     // on to the next statement parsing
     if (pState.getStackTop()->aType == AstNodeTypes::aCLASS)
     {
@@ -1131,6 +1346,10 @@ void Parser::blockCloseStateBeh(ParserState &pState)
     {
         pState.fsmCurState = ParseFsmStates::sINIT;
     }
+    else
+    {
+        syntaxError("}");
+    }
 }
 
 bool Parser::varDeclStateBeh(ParserState &pState)
@@ -1153,6 +1372,8 @@ bool Parser::varDeclStateBeh(ParserState &pState)
         auto &varToken = pState.advanceAndGet();
         if (pState.getTokensFinished())
             return pState.fsmTerminate(false);
+        if (varToken.tType != TokenTypes::tIDENTIFIER)
+            return syntaxError("VARIABLE NAME");
 
         // id is index (actual vector index) in pState.identifiers;
         // can be used to look-up the actual string
@@ -1162,13 +1383,13 @@ bool Parser::varDeclStateBeh(ParserState &pState)
         {
 #ifdef ERR_DEBUG
             assert (nameID < pState.getIdent()->size());
-            std::cerr << "ERR: VARIABLE REDECLARATION: " << pState.getIdent()->at(nameID) << '\n';
+            pState.err() << "ERR: VARIABLE REDECLARATION: " << pState.getIdent()->at(nameID) << '\n';
 #endif
             // TODO: error: variable redeclaration
         }
         else
         {
-            pState.addLocalScopeFramesTopVar(nameID, tType_to_ldType(valTypeToken.tType));
+            pState.addCurParseFuncLocal(nameID, tType_to_ldType(valTypeToken.tType));
         }
 
         auto &token = pState.advanceAndGet();
@@ -1195,8 +1416,8 @@ bool Parser::varAssignStateBeh(ParserState &pState)
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
 
-    assert (varToken.tType == TokenTypes::tIDENTIFIER);
-    assert(varToken.tVal.has_value());
+    if (varToken.tType != TokenTypes::tIDENTIFIER)
+        return syntaxError("VARIABLE NAME");
     const unsigned int nameID = varToken.tVal.value();
 
     pState.advance();
@@ -1232,14 +1453,14 @@ bool Parser::varAssignStateBeh(ParserState &pState)
             }
             else
             {
-                std::cerr << "ERR: NOT  VARIABLE NAME: " 
+                pState.err() << "ERR: NOT  VARIABLE NAME: " 
                     << pState.getIdent()->at(varToken.tVal.value()) << '\n';
                 // TODO: error: not a variable name
             }
         }
         else
         {
-            std::cerr << "ERR: UNKNOWN VARIABLE NAME: " 
+            pState.err() << "ERR: UNKNOWN VARIABLE NAME: " 
                 << pState.getIdent()->at(varToken.tVal.value()) << '\n';
             // TODO: error: unknown variable name
         }
@@ -1267,15 +1488,22 @@ bool Parser::varAssignStateBeh(ParserState &pState)
             return pState.fsmTerminate(false);
     }
 
+    if (pState.getFsmFinished())
+        return false;
+    if (pState.getCurToken().tType != TokenTypes::tEQUAL)
+        return syntaxError("=");
     // skipping =
     pState.advance();
     if (pState.getTokensFinished())
         return pState.fsmTerminate(false);
 
     parseExpr(pState);
-    // making sure parseExpr didnt mess up stacl top:
-    // we need it to be aLET (parent of expr and LOCAL_WRITE/ARG_WRITE/etc.)
-    assert(pState.getStackTop()->aType == AstNodeTypes::aLET);
+    if (pState.getFsmFinished())
+        return false;
+    // parseExpr has to leave aLET on the stack top
+    // (parent of expr and LOCAL_WRITE/ARG_WRITE/etc.)
+    if (pState.getStackTop() == NULL || pState.getStackTop()->aType != AstNodeTypes::aLET)
+        return syntaxError(";");
 
     // array case
     if (assigningArrayElem)
@@ -1306,12 +1534,102 @@ bool Parser::varAssignStateBeh(ParserState &pState)
     }
     // NOTE: cannot be a class obj name, because class members
     // are only set through setters
-    std::cerr << "ERR: UNKNOWN VARIABLE NAME: " << pState.getIdent()->at(nameID) << '\n';
+    pState.err() << "ERR: UNKNOWN VARIABLE NAME: " << pState.getIdent()->at(nameID) << '\n';
     // TODO: error: unknown variable name
     return pState.fsmTerminate(false);
 }
 
-AstNode *Parser::buildAST(tokensVect &tokens, identifierVect &identifiers, unsigned int tokenOffset)
+bool Parser::checkLimits()
+{
+    std::ostringstream hit;
+    if (maxAstNodes != 0 && aralloc.size() > maxAstNodes)
+        hit << "MORE THAN " << maxAstNodes << " AST NODES (--max-ast-nodes)";
+    else if (deadline != std::chrono::steady_clock::time_point::max()
+        && std::chrono::steady_clock::now() > deadline)
+        hit << "OUT OF TIME (--max-file-ms)";
+    else
+        return true;
+
+    // by whichever pass hits it, a unit stopped in
+    // the signature pass isn't parsed again
+    stoppedAtLimit = true;
+    pState.err() << "ERR: LIMIT: " << filePath << ": " << hit.str() << ", line number: " <<
+        pState.getCurToken().debug_lineNum + 1 << '\n';
+    return pState.fsmTerminate(false);
+}
+
+uint64_t Parser::identHash(unsigned int nameID)
+{
+    return std::hash<std::string>()((*pState.getIdent())[nameID]);
+}
+
+uint64_t Parser::typeHash(LangDataTypes ldType)
+{
+    if (ldType < LangDataTypes::ldCLASS)
+        return (uint64_t)ldType;
+    return identHash(pState.getClassByID(ldType_to_classID(ldType)).nameID);
+}
+
+void Parser::addFuncCallee(int classID, unsigned int funcNameID, bool contains, unsigned int funcID)
+{
+    // the current class for -1
+    funcCallees.add(identHash(pState.getClassByID(classID).nameID));
+    funcCallees.add(identHash(funcNameID));
+    funcCallees.add(contains);
+    if (!contains)
+        return;
+
+    const FunctionData &callee = pState.getFuncByIDFromClass(funcID, classID);
+    funcCallees.add(callee.isMethod);
+    funcCallees.add(callee.isCtor);
+    funcCallees.add(typeHash(callee.ldType_ret));
+    funcCallees.add(callee.getNumOfPars());
+}
+
+void Parser::addFuncKey(const AstNode *funcNode)
+{
+    const tokensVect &tokens = *(pState.getTokens());
+    // past the }, it stays the current token if it's the last one
+    const unsigned int endTokenId = pState.getCurTokenID() + pState.getTokensFinished();
+
+    FuncCodeCache::Key key = funcCallees;
+    for (unsigned int i = funcStartTokenId; i < endTokenId; ++i)
+    {
+        key.add((uint64_t)tokens[i].tType);
+        if (tokens[i].tType == TokenTypes::tIDENTIFIER)
+            key.add(identHash(tokens[i].tVal.value()));
+        else if (tokens[i].tVal.has_value())
+            key.add((unsigned int)tokens[i].tVal.value());
+    }
+    key.numTokens = endTokenId - funcStartTokenId;
+
+    const ClassData &curClass = *(pState.getCurParseClass());
+    key.add(identHash(curClass.nameID));
+    for (const auto *vars : {&curClass.getFieldVars(), &curClass.getStaticVars()})
+    {
+        key.add(vars->size());
+        for (const auto &var : *vars)
+        {
+            key.add(identHash(var.nameID));
+            key.add(typeHash(var.valueType));
+        }
+    }
+
+    funcKeys[funcNode] = key;
+}
+
+bool Parser::syntaxError(const char *expected)
+{
+    if (!pState.getFsmFinished() && pState.getParsePass() == ParsePasses::ppBODIES)
+    {
+        const TokenData &token = pState.getCurToken();
+        pState.err() << "ERR: " << filePath << ": EXPECTED " << expected << ", BUT FOUND " <<
+            tType_to_string(token.tType) << ", line number: " << token.debug_lineNum + 1 << '\n';
+    }
+    return pState.fsmTerminate(false);
+}
+
+AstNode *Parser::buildAST(tokensVect &tokens, const identifierVect &identifiers, unsigned int tokenOffset)
 {
     pState.setTokens(&tokens);
     pState.setIdentifiers(&identifiers);
@@ -1325,6 +1643,9 @@ AstNode *Parser::buildAST(tokensVect &tokens, identifierVect &identifiers, unsig
     while (!pState.getFsmFinished())
     {
         debug_strm.str(std::string());
+
+        if (!checkLimits())
+            break;
         
         // means we have just finished declaring local variables
         // for current parse func
@@ -1335,11 +1656,29 @@ AstNode *Parser::buildAST(tokensVect &tokens, identifierVect &identifiers, unsig
             assert (funcRootNode != NULL);
             auto *funcLocNumNode = getFuncLocNumNode(funcRootNode);
             assert (funcLocNumNode != NULL);
-            funcLocNumNode->overwriteNodeValue(pState.getCurParseFunc()->getNumOfLocals());
+            funcLocNumNode->overwriteNodeValue(pState.recordCurParseFuncLocals());
 
             pState.declaringLocals = false;
         }
 
+        // var declarations come first in a function body, so by any other
+        // state (but the decision one) the number of locals is final
+        if (directGen != NULL &&
+            pState.fsmCurState != ParseFsmStates::sSTATEMENT_DECIDE &&
+            pState.fsmCurState != ParseFsmStates::sVAR_DECL)
+        {
+            emitFinishedNodes();
+        }
+
+        // the class level states are the only ones no step
+        // holds on to a token across, so the window moves there
+        if (tokenFeed != NULL && (pState.fsmCurState == ParseFsmStates::sINIT ||
+            pState.fsmCurState == ParseFsmStates::sCLASS_DECIDE))
+        {
+            feedTokens();
+        }
+
+        stateVisits[(size_t)pState.fsmCurState]++;
         switch (pState.fsmCurState)
         {
         case ParseFsmStates::sINIT:
@@ -1431,10 +1770,32 @@ AstNode *Parser::buildAST(tokensVect &tokens, identifierVect &identifiers, unsig
         }
 #ifdef DEBUG
         if (!ignore)
-            std::cout << debug_strm.str();
+            pState.log() << debug_strm.str();
         ignore = false;
 #endif
     }
 
+    // the signature pass stops at the same place
+    // in the tokens, reported once
+    if (!pState.fsmFinishedCorrectly && pState.getParsePass() == ParsePasses::ppBODIES)
+    {
+        pState.err() << "ERR: PARSING STOPPED, line number: " << 
+            pState.getCurToken().debug_lineNum + 1 << '\n';
+    }
+
+    if (directGen != NULL)
+    {
+        directGen->generatePending(astRoot);
+        aralloc.releaseFrom(astRoot);
+        astRoot = NULL;
+    }
+
+    // stopped inside of them
+    while (traceOpen > 0)
+        traceParserEnd();
+
+    // the nodes have copies of what they need of the tokens,
+    // the caller can release them
+    pState.setTokens(NULL);
     return astRoot;
 }
\ No newline at end of file
@@ -1,33 +1,32 @@
 #include "ParserTypes.h"
 
 AstNode::AstNode(TokenData &token) : DebugData(token.debug_lineNum), 
-    aType(tType_to_aType(token.tType)), nID(assignId()), 
-    generatesCode(checkGeneratesCode(aType))
+    aType(tType_to_aType(token.tType)), generatesCode(checkGeneratesCode(aType))
 {
     if (token.tVal.has_value())
         aVal = token.tVal.value();
 }
 
 AstNode::AstNode(TokenData &token, int precCoeff) : DebugData(token.debug_lineNum), aType(tType_to_aType(token.tType)),
-    nPrecCoeff(precCoeff), nID(assignId()), generatesCode(checkGeneratesCode(aType))
+    nPrecCoeff(precCoeff), generatesCode(checkGeneratesCode(aType))
 {
     if (token.tVal.has_value())
         aVal = token.tVal.value();
 }
 
-AstNode::AstNode(AstNodeTypes aType) : DebugData(0), aType(aType), nID(assignId()),
+AstNode::AstNode(AstNodeTypes aType) : DebugData(0), aType(aType),
     generatesCode(checkGeneratesCode(aType))
 {}
 
-AstNode::AstNode(AstNodeTypes aType, int aVal) : DebugData(0), aType(aType), aVal(aVal), nID(assignId()),
+AstNode::AstNode(AstNodeTypes aType, int aVal) : DebugData(0), aType(aType), aVal(aVal),
     generatesCode(checkGeneratesCode(aType))
 {}
 
 AstNode::AstNode(AstNodeTypes aType, const std::string &aVal) : DebugData(0), aType(aType), aVal(aVal), 
-    nID(assignId()), generatesCode(checkGeneratesCode(aType))
+    generatesCode(checkGeneratesCode(aType))
 {}
 
-AstNode::AstNode() : DebugData(0), aType(AstNodeTypes::aROOT), nID(assignId()), 
+AstNode::AstNode() : DebugData(0), aType(AstNodeTypes::aROOT),
     generatesCode(checkGeneratesCode(AstNodeTypes::aROOT))
 {}
 
@@ -75,6 +74,9 @@ void AstNode::addChild(AstNode *child)
                     ", line number: " << debug_lineNum << '\n';       
 #endif
     assert(child != NULL);
+    // most nodes with children are operators, with two
+    if (nChildNodes.capacity() == 0)
+        nChildNodes.reserve(2);
     nChildNodes.push_back(child);
     nChildNodes.back()->setParent(this);
 }
@@ -96,26 +98,26 @@ bool AstNode::containsChildNode(int nID)
 }
 
 #if defined(DEBUG) || defined(PARSER_DEBUG)
-void AstNode::print()
+void AstNode::print(std::ostream &strm)
 {
-    std::cout << "AstNode #" << nID << '\n';
-    std::cout << "Type: " << aType_to_string(aType) << '\n';
+    strm << "AstNode #" << nID << '\n';
+    strm << "Type: " << aType_to_string(aType) << '\n';
 
     if (std::holds_alternative<int>(aVal))
-        std::cout << "Val: " << std::to_string(std::get<int>(aVal))  << '\n';
+        strm << "Val: " << std::to_string(std::get<int>(aVal))  << '\n';
     else if(std::holds_alternative<std::string>(aVal))
-        std::cout << "Val: " << std::get<std::string>(aVal) << '\n';
+        strm << "Val: " << std::get<std::string>(aVal) << '\n';
     else
-        std::cout << "Val: None\n";
+        strm << "Val: None\n";
 
-    std::cout << "Children size: " << nChildNodes.size()  << '\n';
-    std::cout << "Children:";
+    strm << "Children size: " << nChildNodes.size()  << '\n';
+    strm << "Children:";
     for (auto *elem : nChildNodes)
     {
-        std::cout << " #" << elem->nID;
+        strm << " #" << elem->nID;
     }
-    std::cout << '\n';
-    std::cout << '\n';
+    strm << '\n';
+    strm << '\n';
 }
 #endif
 
@@ -127,13 +129,10 @@ ClassData &ParserState::getClassByID(int classID)
         assert(getCurParseClass() != NULL);
         // we could have just said return return *(getCurParseClass()),
         // but with this we ensure that we DO return an actual class
-        // from classes container
+        // from the class table
         return getClassByID(getCurParseClass()->getID());
     }
-    assert(!classes.empty());
-    assert(classID < classes.size());
-    assert(classID == classes[classID].getID());
-    return classes[classID];
+    return classTable.getByID(classID);
 }
 
 const FunctionData &ParserState::getFuncByIDFromClass(unsigned int funcID, int classID)
@@ -147,48 +146,31 @@ const FunctionData &ParserState::getFuncByIDFromClass(unsigned int funcID, int c
 
 std::tuple<bool, unsigned int> ParserState::containsClass(unsigned int nameID)
 {
-    auto iter = std::find_if(classes.begin(), classes.end(), 
-        [&nameID](const ClassData  &arg){ return arg.nameID == nameID; });
-
-    return {iter != classes.end(), 
-            std::distance(classes.begin(), iter)};
+    return classTable.find(nameID);
 }
 
 IDable::idx_in_cont ParserState::addClass(unsigned int nameID, bool isDefined)
 {
-    // the next var needed purely due to pointer invalidation after reseizing
-    unsigned int curParseClassIdx = 0;
-    bool restateCurParseClass = false;
-    if (curParseClass != NULL)
-    {
-        restateCurParseClass = true;
-        curParseClassIdx = curParseClass->getID();
-    }
-
-    auto &curClass = classes.emplace_back(nameID);
-    curClass.setIsDefined(isDefined);
-    curClass.setID(classes.size()-1);
+    const unsigned int classID = classTable.findOrAdd(nameID);
+    auto &curClass = classTable.getByID(classID);
     // isDefined == true -> we are in the class definition,
     // so this becomes the current class being parsed
     if (isDefined)
     {
+        curClass.setIsDefined(isDefined);
         curParseClass = &curClass;
-    }
-    else if (restateCurParseClass)
-    {
-        // resizing on .emplace_back causes pointer invalidation
-        curParseClass = &(classes[curParseClassIdx]);
+        curParseFuncID = -1;
     }
 
     return curClass.getID();
 }
 // TODO: CHECKER: after parsing the whole prog (all files):
 // run though classes and see that none have isDefined == false
-// classID as idx in classes container
+// classID as idx in the class table
 void ParserState::setCurParseClass(unsigned int classID)
 {
-    assert(classID < classes.size());
-    curParseClass = &(classes[classID]);
+    curParseClass = &(classTable.getByID(classID));
+    curParseFuncID = -1;
     // this is the class we are currently defining
     curParseClass->setIsDefined(true);
 }
@@ -205,7 +187,30 @@ void ParserState::addCurParseClassStaticVar(unsigned int nameID, LangDataTypes v
 bool ParserState::addCurParseClassFunc(unsigned int nameID, LangDataTypes ldType_ret,
     bool isMethod, bool isCtor)
 {
-    return getCurParseClass()->addFunc(nameID, ldType_ret, isMethod, isCtor);
+    auto *curParseClass = getCurParseClass();
+    if (parsePass == ParsePasses::ppBODIES)
+    {
+        // the signature pass has added the functions
+        // of the class in this same order
+        const unsigned int funcID = curParseFuncID + 1;
+        if (funcID >= curParseClass->getFuncs().size() ||
+            curParseClass->getFuncs()[funcID].nameID != nameID)
+        {
+            return false;
+        }
+        curParseFuncID = funcID;
+    }
+    else
+    {
+        if (!curParseClass->addFunc(nameID, ldType_ret, isMethod, isCtor))
+            return false;
+        curParseFuncID = curParseClass->getFuncs().size() - 1;
+    }
+
+    funcLocals.begin();
+    // labels are numbered per function
+    labelIdPool = 0;
+    return true;
 }
 
 // only for loading system library symbols
@@ -218,25 +223,35 @@ bool ParserState::addFuncToClass(int classID, unsigned int nameID, LangDataTypes
 FunctionData *ParserState::getCurParseFunc() const
 {
     auto *curParseClass = getCurParseClass();
-    if (curParseClass == NULL)
+    if (curParseClass == NULL || curParseFuncID < 0)
         return NULL;
-    return curParseClass->getLastFunc();
+    return curParseClass->getFunc(curParseFuncID);
 }
 void ParserState::addCurParseFuncPar(unsigned int nameID, LangDataTypes ldType_par)
 {
-    auto *curParseClass = getCurParseClass();
-    if (curParseClass != NULL)
+    // known from the signature pass
+    if (parsePass == ParsePasses::ppBODIES)
+        return;
+
+    auto *curParseFunc = getCurParseFunc();
+    if (curParseFunc != NULL)
     {
-        curParseClass->addFuncPar(nameID, ldType_par);
+        curParseFunc->addPar(nameID, ldType_par);
     }
 }
-void ParserState::addLocalScopeFramesTopVar(unsigned int nameID, LangDataTypes valueType)
+void ParserState::addCurParseFuncLocal(unsigned int nameID, LangDataTypes valueType)
 {
-    getCurParseFunc()->addLocalScopeFramesTopVar(nameID, valueType);
+    funcLocals.addVar(nameID, valueType);
 }
-bool ParserState::popLocalScopeFramesTop()
-{   
-    return getCurParseFunc()->popLocalScopeFramesTop(); 
+void ParserState::closeCurParseFuncLocals()
+{
+    funcLocals.end();
+}
+unsigned int ParserState::recordCurParseFuncLocals()
+{
+    auto *curParseFunc = getCurParseFunc();
+    curParseFunc->setNumOfLocals(funcLocals.getNumOfLocals());
+    return curParseFunc->getNumOfLocals();
 }
 std::tuple<bool, unsigned int> ParserState::containsArg(int identNameID)
 {
@@ -244,7 +259,7 @@ std::tuple<bool, unsigned int> ParserState::containsArg(int identNameID)
 }
 std::tuple<bool, unsigned int> ParserState::containsLocal(int identNameID)
 {
-    return getCurParseFunc()->containsLocal(identNameID);
+    return funcLocals.containsVar(identNameID);
 }
 std::tuple<bool, unsigned int> ParserState::containsField(int identNameID)
 {
@@ -261,7 +276,7 @@ const VariableData &ParserState::getArgVar(unsigned int idx) const
 }
 const VariableData &ParserState::getLocalVar(unsigned int idx) const
 {
-    return getCurParseFunc()->getLocalVar(idx);
+    return funcLocals.getVar(idx);
 }
 const VariableData &ParserState::getFieldVar(unsigned int idx) const
 {
@@ -272,11 +287,10 @@ const VariableData &ParserState::getStaticVar(unsigned int idx) const
     return getCurParseClass()->getStaticVar(idx);
 }
 
-ParserState::ParserState()
+ParserState::ParserState(ClassTable &classTable) : classTable(classTable)
 {
     arrayLib_classID = 0;
     identifiers = NULL;
-    classes.clear();
     resetNonShared();
 }
 
@@ -284,7 +298,7 @@ void ParserState::setTokens(tokensVect *tokensPar)
 {
     tokens = tokensPar;
 }
-void ParserState::setIdentifiers(identifierVect *identifiersPar)
+void ParserState::setIdentifiers(const identifierVect *identifiersPar)
 {
     identifiers = identifiersPar;
 }
@@ -296,19 +310,22 @@ void ParserState::resetNonShared()
     curTokenId = 0;
     tokensFinished = false;
     curParseClass = NULL;
+    curParseFuncID = -1;
     layerCoeff = 0;
     arrayEnteryNum = 0;
     fsmFinished = false;
     fsmFinishedCorrectly = true;
     fsmCurState = ParseFsmStates::sINIT;
     declaringLocals = false;
+    nodeIdPool = 0;
+    labelIdPool = 0;
 
     while (!pendParentNodes.empty())
         pendParentNodes.pop();
 
-    // NOTE: we are not resetting classes,
-    // because they are SHARED between
-    // multiple translation units.
+    // NOTE: we are not resetting the class table
+    // and the parse pass, because they are SHARED
+    // between multiple translation units.
     
     // This function only resets the individual
     // state for each input source file.
@@ -354,9 +371,7 @@ LangDataTypes ParserState::checkCreateUserDefinedDataType(const TokenData &token
     {
         // "extending" LangDataTypes enum, by adding class id in classes to class offset
         // in the enum (LangDataTypes::ldCLASS)
-        classID = getClasses().size();
-        const bool isDefined = false;
-        addClass(classNameID, isDefined);
+        classID = classTable.findOrAdd(classNameID);
     }
 
     return classID_to_ldType(classID);
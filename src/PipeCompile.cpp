@@ -0,0 +1,155 @@
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <cctype>
+
+#include "PipeCompile.h"
+#include "FileDiscovery.h"
+#include "CompileDriver.h"
+#include "Generator.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+bool isIdentChar(char c)
+{
+    return std::isalnum((unsigned char)c) || c == '_';
+}
+
+bool isWordAt(const std::string &text, size_t pos, const std::string &word)
+{
+    return text.compare(pos, word.size(), word) == 0 &&
+        (pos == 0 || !isIdentChar(text[pos - 1])) &&
+        (pos + word.size() == text.size() || !isIdentChar(text[pos + word.size()]));
+}
+
+}
+
+std::vector<StreamClass> splitClasses(const std::string &stream)
+{
+    const std::string classKeyword = "class";
+    std::vector<size_t> classStarts;
+    unsigned int depth = 0;
+    for (size_t i = 0; i < stream.size(); ++i)
+    {
+        const char c = stream[i];
+        const char nextChar = i + 1 < stream.size() ? stream[i + 1] : '\0';
+        if (c == '/' && nextChar == '/')
+            i = stream.find('\n', i);
+        else if (c == '/' && nextChar == '*')
+        {
+            i = stream.find("*/", i + 2);
+            if (i != std::string::npos)
+                ++i;
+        }
+        else if (c == '"')
+            i = stream.find('"', i + 1);
+        else if (c == '{')
+            ++depth;
+        else if (c == '}' && depth > 0)
+            --depth;
+        else if (depth == 0 && isWordAt(stream, i, classKeyword))
+        {
+            classStarts.push_back(i);
+            i += classKeyword.size() - 1;
+        }
+
+        if (i == std::string::npos)
+            break;
+    }
+
+    std::vector<StreamClass> classes;
+    if (classStarts.empty())
+    {
+        // not a class, but the lexer and the parser say what's wrong
+        const bool blank = std::all_of(stream.begin(), stream.end(),
+            [](char c) { return std::isspace((unsigned char)c); });
+        if (!blank)
+            classes.push_back({"stdin", stream});
+        return classes;
+    }
+
+    size_t numLinesBefore = 0;
+    for (size_t classIdx = 0; classIdx < classStarts.size(); ++classIdx)
+    {
+        const size_t start = classIdx == 0 ? 0 : classStarts[classIdx];
+        const size_t end = classIdx + 1 < classStarts.size() ? classStarts[classIdx + 1] : stream.size();
+
+        size_t nameStart = classStarts[classIdx] + classKeyword.size();
+        while (nameStart < end && std::isspace((unsigned char)stream[nameStart]))
+        {
+            ++nameStart;
+        }
+        size_t nameEnd = nameStart;
+        while (nameEnd < end && isIdentChar(stream[nameEnd]))
+        {
+            ++nameEnd;
+        }
+
+        StreamClass &streamClass = classes.emplace_back();
+        streamClass.name = nameEnd > nameStart ?
+            stream.substr(nameStart, nameEnd - nameStart) : "stdin" + std::to_string(classIdx);
+        streamClass.text.reserve(numLinesBefore + end - start);
+        streamClass.text.assign(numLinesBefore, '\n');
+        streamClass.text.append(stream, start, end - start);
+
+        numLinesBefore += std::count(stream.begin() + start, stream.begin() + end, '\n');
+    }
+    return classes;
+}
+
+bool pipeCompile(const CompilerOptions &options, const DiscoveryOptions &discovery,
+    ThreadPool &pool, const std::vector<std::string> &libsPaths,
+    std::istream &in, std::ostream &out, std::ostream &err)
+{
+    std::vector<std::string> libFilePaths;
+    if (!discoverFiles(libsPaths, discovery, pool, libFilePaths, NULL, err))
+        return false;
+
+    const std::string stream((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<StreamClass> classes = splitClasses(stream);
+
+    std::vector<SourceUnit> units(libFilePaths.size() + classes.size());
+    std::vector<FileRead> reads;
+    for (size_t i = 0; i < libFilePaths.size(); ++i)
+    {
+        units[i].filePath = libFilePaths[i];
+        units[i].name = fs::path(libFilePaths[i]).stem().string();
+        reads.push_back({&units[i].filePath, &units[i].text});
+    }
+    BatchIO io(pool, options.ioUring);
+    io.readFiles(reads);
+    for (const auto &read : reads)
+    {
+        if (read.done)
+            continue;
+        err << "ERR: CAN'T READ " << *read.path << '\n';
+        return false;
+    }
+
+    for (size_t classIdx = 0; classIdx < classes.size(); ++classIdx)
+    {
+        SourceUnit &unit = units[libFilePaths.size() + classIdx];
+        unit.filePath = "stdin";
+        unit.name = std::move(classes[classIdx].name);
+        unit.text = std::move(classes[classIdx].text);
+    }
+
+    CompilerContext context(options);
+    const bool success = compileUnits(context, pool, units, true);
+
+    for (const auto &unit : units)
+    {
+        err << unit.diagnostics.str();
+        // no frame for the code of a class the parser gave up on
+        if (!unit.lexed || (!unit.parsed && unit.numTokens != 0))
+            continue;
+
+        out << "@@ " << unit.name << '.' << outFileExt << ' ' << unit.vmCode.size() << '\n';
+        out << unit.vmCode;
+    }
+    out.flush();
+    return success;
+}
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include "ShardedBuild.h"
+#include "CompileDriver.h"
+#include "BuildRecords.h"
+#include "ByteStream.h"
+
+namespace
+{
+
+struct Worker
+{
+    pid_t pid = -1;
+    int readFd = -1;
+    // the shard's units not reported yet, in the order they're compiled
+    std::vector<size_t> pendingUnitIdxs;
+    std::string received;
+};
+
+bool writeAll(int fd, const std::string &bytes)
+{
+    for (size_t written = 0; written < bytes.size(); )
+    {
+        const ssize_t res = write(fd, bytes.data() + written, bytes.size() - written);
+        if (res < 0 && errno == EINTR)
+            continue;
+        if (res <= 0)
+            return false;
+        written += res;
+    }
+    return true;
+}
+
+// In the forked process, never returns. Every unit is reported as soon
+// as it's done, a message is its length and then the unit's results.
+// The context is the coordinator's after phase 1, inherited copy-on-write:
+// phase 2 only reads the symbols, the pages stay shared between the workers.
+void runWorker(CompilerContext &context, std::vector<SourceUnit> &units,
+    const std::vector<size_t> &unitIdxs, int writeFd)
+{
+    const CompilerOptions &options = context.getOptions();
+    ThreadPool pool(1);
+    BatchIO io(pool, options.ioUring);
+    for (size_t unitIdx : unitIdxs)
+    {
+        std::vector<SourceUnit> oneUnit(1);
+        oneUnit[0] = std::move(units[unitIdx]);
+        oneUnit[0].schedulePos = 0;
+        generateUnits(context, pool, oneUnit, false, &io);
+
+        const SourceUnit &unit = oneUnit[0];
+        ByteWriter writer;
+        writer.putU32(unitIdx);
+        writer.putU32(unit.parsed);
+        writer.putString(unit.log.str());
+        writer.putString(unit.diagnostics.str());
+        writer.putU32(unit.funcDeps.size());
+        for (const auto &[funcName, signature] : unit.funcDeps)
+        {
+            writer.putString(funcName);
+            writer.putString(signature);
+        }
+
+        ByteWriter message;
+        message.putU32(writer.bytes.size());
+        message.bytes += writer.bytes;
+        if (!writeAll(writeFd, message.bytes))
+            _exit(1);
+    }
+    _exit(0);
+}
+
+bool startWorker(Worker &worker, CompilerContext &context, std::vector<SourceUnit> &units,
+    std::ostream &err)
+{
+    int pipeFds[2];
+    if (pipe(pipeFds) < 0)
+    {
+        err << "Can't create a pipe for a worker: " << strerror(errno) << '\n';
+        return false;
+    }
+
+    worker.pid = fork();
+    if (worker.pid < 0)
+    {
+        err << "Can't start a worker: " << strerror(errno) << '\n';
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        return false;
+    }
+    if (worker.pid == 0)
+    {
+        close(pipeFds[0]);
+        runWorker(context, units, worker.pendingUnitIdxs, pipeFds[1]);
+    }
+
+    close(pipeFds[1]);
+    worker.readFd = pipeFds[0];
+    worker.received.clear();
+    return true;
+}
+
+// the complete messages received so far into the units
+void takeResults(Worker &worker, std::vector<SourceUnit> &units)
+{
+    size_t consumed = 0;
+    while (true)
+    {
+        ByteReader lenReader(worker.received.data() + consumed, worker.received.size() - consumed);
+        uint32_t messageLen = 0;
+        if (!lenReader.getU32(messageLen) || worker.received.size() - consumed - sizeof(messageLen) < messageLen)
+            break;
+
+        ByteReader reader(worker.received.data() + consumed + sizeof(messageLen), messageLen);
+        consumed += sizeof(messageLen) + messageLen;
+
+        uint32_t unitIdx = 0, parsed = 0, numDeps = 0;
+        std::string log, diagnostics;
+        reader.getU32(unitIdx);
+        reader.getU32(parsed);
+        reader.getString(log);
+        reader.getString(diagnostics);
+        reader.getU32(numDeps);
+        auto pendingIt = std::find(worker.pendingUnitIdxs.begin(), worker.pendingUnitIdxs.end(), unitIdx);
+        if (reader.getFailed() || pendingIt == worker.pendingUnitIdxs.end())
+            continue;
+
+        SourceUnit &unit = units[unitIdx];
+        unit.parsed = parsed;
+        unit.log << log;
+        unit.diagnostics << diagnostics;
+        for (uint32_t depIdx = 0; depIdx < numDeps; ++depIdx)
+        {
+            std::string funcName, signature;
+            reader.getString(funcName);
+            reader.getString(signature);
+            unit.funcDeps[funcName] = signature;
+        }
+        // no other worker is started with it anymore
+        unit.lexState.releaseTokens();
+        worker.pendingUnitIdxs.erase(pendingIt);
+    }
+    worker.received.erase(0, consumed);
+}
+
+// The worker's pipe is closed: whatever it didn't report failed.
+// Killed by a signal it crashed on the first pending unit,
+// the rest are given to a new worker. True if one was started.
+bool finishWorker(Worker &worker, CompilerContext &context, std::vector<SourceUnit> &units,
+    std::ostream &err)
+{
+    close(worker.readFd);
+    worker.readFd = -1;
+
+    int status = 0;
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR)
+    {}
+    worker.pid = -1;
+
+    takeResults(worker, units);
+    if (worker.pendingUnitIdxs.empty())
+        return false;
+
+    if (WIFSIGNALED(status))
+    {
+        SourceUnit &unit = units[worker.pendingUnitIdxs.front()];
+        unit.parsed = false;
+        unit.diagnostics << "ERR: THE WORKER COMPILING " << unit.filePath
+            << " WAS KILLED BY SIGNAL " << WTERMSIG(status) << '\n';
+        worker.pendingUnitIdxs.erase(worker.pendingUnitIdxs.begin());
+        if (!worker.pendingUnitIdxs.empty() && startWorker(worker, context, units, err))
+            return true;
+    }
+
+    for (size_t unitIdx : worker.pendingUnitIdxs)
+    {
+        units[unitIdx].parsed = false;
+        units[unitIdx].diagnostics << "ERR: NOT COMPILED, THE WORKER FAILED\n";
+    }
+    worker.pendingUnitIdxs.clear();
+    return false;
+}
+
+}
+
+bool shardedCompile(const CompilerOptions &options, const std::vector<std::string> &filePaths,
+    unsigned int numShards, std::ostream &out, std::ostream &err)
+{
+    std::vector<SourceUnit> units(filePaths.size());
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        units[i].filePath = filePaths[i];
+    }
+
+    BuildRecords records(options);
+    if (!options.rebuildAll)
+        records.load(BuildRecords::recordsPath(options.outDir));
+
+    CompilerContext context(options);
+    {
+        // no threads may be left once the workers are forked
+        ThreadPool pool(options.jobs);
+        BatchIO io(pool, options.ioUring);
+        lexUnits(pool, units, options.limits, false, NULL, &io);
+        parseSignatures(context, pool, units, options.scheduleReport ? &out : NULL);
+    }
+    records.markOutOfDate(context, units, options.outDir);
+
+    // the shards balanced by the tokens, each starting with its biggest unit
+    std::vector<size_t> toGenerate;
+    for (size_t unitIdx = 0; unitIdx < units.size(); ++unitIdx)
+    {
+        SourceUnit &unit = units[unitIdx];
+        if (unit.generate && unit.lexed && unit.numTokens != 0 && !unit.overLimit)
+            toGenerate.push_back(unitIdx);
+        else
+            unit.lexState.releaseTokens();
+    }
+    std::stable_sort(toGenerate.begin(), toGenerate.end(), [&units](size_t lhsIdx, size_t rhsIdx)
+    {
+        return units[lhsIdx].numTokens > units[rhsIdx].numTokens;
+    });
+
+    std::vector<Worker> workers(std::min<size_t>(numShards, toGenerate.size()));
+    std::vector<size_t> shardCosts(workers.size(), 0);
+    for (size_t unitIdx : toGenerate)
+    {
+        const size_t shardIdx = std::min_element(shardCosts.begin(), shardCosts.end()) - shardCosts.begin();
+        workers[shardIdx].pendingUnitIdxs.push_back(unitIdx);
+        shardCosts[shardIdx] += units[unitIdx].numTokens;
+    }
+
+    // nothing buffered may be written twice, by a worker too
+    out.flush();
+    err.flush();
+
+    bool success = true;
+    for (auto &worker : workers)
+    {
+        if (startWorker(worker, context, units, err))
+            continue;
+        for (size_t unitIdx : worker.pendingUnitIdxs)
+        {
+            units[unitIdx].parsed = false;
+        }
+        worker.pendingUnitIdxs.clear();
+        success = false;
+    }
+
+    while (true)
+    {
+        std::vector<pollfd> pollFds;
+        std::vector<Worker*> polledWorkers;
+        for (auto &worker : workers)
+        {
+            if (worker.readFd < 0)
+                continue;
+            pollFds.push_back({worker.readFd, POLLIN, 0});
+            polledWorkers.push_back(&worker);
+        }
+        if (pollFds.empty())
+            break;
+
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            err << "Can't wait for the workers: " << strerror(errno) << '\n';
+            return false;
+        }
+
+        for (size_t pollIdx = 0; pollIdx < pollFds.size(); ++pollIdx)
+        {
+            if (pollFds[pollIdx].revents == 0)
+                continue;
+
+            Worker &worker = *polledWorkers[pollIdx];
+            char buffer[1 << 16];
+            const ssize_t numRead = read(worker.readFd, buffer, sizeof(buffer));
+            if (numRead < 0 && errno == EINTR)
+                continue;
+            if (numRead > 0)
+            {
+                worker.received.append(buffer, numRead);
+                takeResults(worker, units);
+                continue;
+            }
+            finishWorker(worker, context, units, err);
+        }
+    }
+
+    success = unitsSucceeded(units) && success;
+    records.update(units);
+    records.save(BuildRecords::recordsPath(options.outDir));
+
+    for (const auto &unit : units)
+    {
+        out << unit.lexLog.str() << unit.log.str();
+        err << unit.diagnostics.str();
+    }
+    return success;
+}
@@ -0,0 +1,48 @@
+#include "SourceCache.h"
+#include "CompileDriver.h"
+
+namespace fs = std::filesystem;
+
+bool FileStamp::read(const std::string &filePath, FileStamp &stamp)
+{
+    std::error_code ec;
+    stamp.modTime = fs::last_write_time(filePath, ec);
+    if (ec)
+        return false;
+    stamp.size = fs::file_size(filePath, ec);
+    return !ec;
+}
+
+bool SourceCache::fetch(SourceUnit &unit, FileStamp &stamp) const
+{
+    if (!FileStamp::read(unit.filePath, stamp))
+        return false;
+
+    std::shared_lock<std::shared_mutex> lock(entriesMutex);
+    auto entryIt = entries.find(unit.filePath);
+    if (entryIt == entries.end() || !(entryIt->second.stamp == stamp))
+        return false;
+
+    const Entry &entry = entryIt->second;
+    unit.name = entry.name;
+    unit.lexState = entry.lexState;
+    unit.lexLog << entry.lexLog;
+    unit.lexed = true;
+    return true;
+}
+
+void SourceCache::store(const SourceUnit &unit, const FileStamp &stamp)
+{
+    std::unique_lock<std::shared_mutex> lock(entriesMutex);
+    Entry &entry = entries[unit.filePath];
+    entry.stamp = stamp;
+    entry.name = unit.name;
+    entry.lexState = unit.lexState;
+    entry.lexLog = unit.lexLog.str();
+}
+
+void SourceCache::erase(const std::string &filePath)
+{
+    std::unique_lock<std::shared_mutex> lock(entriesMutex);
+    entries.erase(filePath);
+}
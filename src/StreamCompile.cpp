@@ -0,0 +1,419 @@
+#include <fstream>
+#include <memory>
+#include <filesystem>
+#include <cassert>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "StreamCompile.h"
+#include "CompileDriver.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Generator.h"
+#include "Trace.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// A file lexed line by line as the parser asks for it, see TokenFeed.
+// The identifiers' ids are the context's by the time the parser sees them.
+class TokenStream
+{
+private:
+    std::ifstream src;
+    std::ostream nullStrm{nullptr};
+    Lexer lexer{nullStrm};
+    // the file's identifiers, in the order the first pass found them
+    const std::vector<unsigned int> &globalIDs;
+    // an identifier the first pass didn't see
+    bool changed = false;
+
+    // how far memberComplete got, kept across the lines and the feeds
+    // so that every token is looked at once. The positions count
+    // the dropped tokens too, they don't move when the window does.
+    size_t scanStart = SIZE_MAX;
+    bool scanClassStart = false;
+    size_t scanPos = 0;
+    int scanDepth = 0;
+    size_t memberEnd = SIZE_MAX;
+
+    bool memberComplete(const tokensVect &tokens, unsigned int curTokenId, bool classStart);
+
+public:
+    // the parser's window into the file
+    LexerState lexState;
+
+    TokenStream(const std::string &filePath, const std::vector<unsigned int> &globalIDs,
+        const ResourceLimits &limits, std::chrono::steady_clock::time_point deadline)
+        : src(filePath), globalIDs(globalIDs)
+    {
+        lexer.setLimits(limits, deadline);
+    }
+
+    bool isOpen() const
+    {
+        return src.is_open();
+    }
+
+    bool getChanged() const
+    {
+        return changed;
+    }
+
+    const std::string &getLimitHit() const
+    {
+        return lexer.getLimitHit();
+    }
+
+    void feed(tokensVect &tokens, unsigned int &curTokenId, bool classStart);
+};
+
+// The tokens from curTokenId on take the class level FSM through its
+// next step: a field or static declaration up to its ;, a subroutine
+// up to the } closing its body, the } closing the class, or for
+// classStart the class header up to its {. The token after
+// it has to be there too, the steps end by advancing to it.
+bool TokenStream::memberComplete(const tokensVect &tokens, unsigned int curTokenId, bool classStart)
+{
+    const size_t dropped = lexState.tokensDropped;
+    const size_t from = dropped + curTokenId;
+    // a new step starts where the last one ended, nothing is scanned twice
+    if (from != scanStart || classStart != scanClassStart)
+    {
+        scanStart = from;
+        scanClassStart = classStart;
+        scanPos = from;
+        scanDepth = 0;
+        memberEnd = SIZE_MAX;
+    }
+
+    for (; memberEnd == SIZE_MAX && scanPos < dropped + tokens.size(); ++scanPos)
+    {
+        switch (tokens[scanPos - dropped].tType)
+        {
+            case TokenTypes::tLCURL:
+                ++scanDepth;
+                if (classStart && scanDepth == 1)
+                    memberEnd = scanPos;
+                break;
+            case TokenTypes::tRCURL:
+                --scanDepth;
+                if (scanDepth <= 0)
+                    memberEnd = scanPos;
+                break;
+            case TokenTypes::tSEMICOLON:
+                if (!classStart && scanDepth == 0)
+                    memberEnd = scanPos;
+                break;
+            default:
+                break;
+        }
+    }
+    return memberEnd != SIZE_MAX && memberEnd + 1 < dropped + tokens.size();
+}
+
+void TokenStream::feed(tokensVect &tokens, unsigned int &curTokenId, bool classStart)
+{
+    assert(&tokens == &lexState.tokens);
+
+    // the one before the current token stays for looking back
+    if (curTokenId > 1)
+    {
+        tokens.erase(tokens.begin(), tokens.begin() + (curTokenId - 1));
+        lexState.tokensDropped += curTokenId - 1;
+        curTokenId = 1;
+    }
+
+    while (!changed && lexer.getMoreLinesComing() && !memberComplete(tokens, curTokenId, classStart))
+    {
+        const size_t numBefore = tokens.size();
+        lexer.lexNextLine(&src, lexState);
+        lexState.reset();
+
+        for (size_t i = numBefore; i < tokens.size(); ++i)
+        {
+            if (tokens[i].tType != TokenTypes::tIDENTIFIER)
+                continue;
+            const unsigned int localID = tokens[i].tVal.value();
+            if (localID >= globalIDs.size())
+            {
+                // the line is dropped, to the parser the file ends here
+                tokens.erase(tokens.begin() + numBefore, tokens.end());
+                changed = true;
+                break;
+            }
+            tokens[i].tVal = globalIDs[localID];
+        }
+    }
+}
+
+// The first pass: the unit's identifiers are left in its lexState,
+// the (local) ids of its class names in classIDs and its number of
+// tokens in its stats, the tokens themselves are dropped line by line
+void scanUnit(SourceUnit &unit, const ResourceLimits &limits, std::vector<unsigned int> &classIDs)
+{
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(unit.filePath, ec);
+    if (ec || overFileSize(unit, size, limits))
+        return;
+
+    const TraceScope trace("lex", unit.filePath);
+
+    std::ifstream src(unit.filePath);
+    if (!src)
+        return;
+
+    std::ostream nullStrm(nullptr);
+    Lexer lexer(nullStrm);
+    lexer.setCurFileName(unit.filePath);
+    const auto start = std::chrono::steady_clock::now();
+    lexer.setLimits(limits, unitDeadline(unit, limits, start));
+
+    LexerState &lexState = unit.lexState;
+    // a class name can be on the line after its class
+    bool afterClass = false;
+    while (lexer.getMoreLinesComing())
+    {
+        lexer.lexNextLine(&src, lexState);
+        lexState.reset();
+
+        for (const auto &token : lexState.tokens)
+        {
+            if (afterClass && token.tType == TokenTypes::tIDENTIFIER)
+                classIDs.push_back(token.tVal.value());
+            afterClass = token.tType == TokenTypes::tCLASS;
+        }
+        lexState.tokensDropped += lexState.tokens.size();
+        lexState.tokens.clear();
+    }
+    unit.busyTime += std::chrono::steady_clock::now() - start;
+
+    unit.name = lexer.getCurFileName();
+    unit.stats.sourceBytes = size;
+    unit.numTokens = lexState.tokensDropped;
+    unit.stats.tokens = unit.numTokens;
+    unit.stats.identifiers = lexState.identifiers.size();
+    if (!lexer.getLimitHit().empty())
+    {
+        unit.diagnostics << "ERR: LIMIT: " << unit.filePath << ": " << lexer.getLimitHit() << '\n';
+        unit.lexState = LexerState();
+        return;
+    }
+    unit.lexed = true;
+}
+
+std::unique_ptr<Parser> newStreamParser(CompilerContext &context, SourceUnit &unit,
+    ParsePasses parsePass, std::ostream &logStrm, std::chrono::steady_clock::time_point deadline)
+{
+    auto parser = std::make_unique<Parser>(context);
+    parser->setParsePass(parsePass);
+    parser->setStreams(logStrm, unit.diagnostics);
+    parser->setLimits(unit.filePath, context.getOptions().limits.maxAstNodes, deadline);
+    return parser;
+}
+
+// Runs parsePass over the unit as the stream comes, the first
+// feed is done here so that the parser never gets an empty window.
+// False if the file can't be read or isn't what the first pass read.
+bool parseStreamed(Parser &parser, TokenStream &stream, const TokenFeed &feed,
+    const identifierVect &identifiers)
+{
+    if (!stream.isOpen())
+        return false;
+
+    unsigned int curTokenId = 0;
+    const bool classStart = true;
+    feed(stream.lexState.tokens, curTokenId, classStart);
+    if (stream.lexState.tokens.empty())
+        return false;
+
+    parser.setTokenFeed(&feed);
+    parser.buildAST(stream.lexState.tokens, identifiers, 0);
+    parser.setTokenFeed(NULL);
+    return !stream.getChanged();
+}
+
+// phase 2 of a unit, its code written to outFilePath as it's generated
+void generateStreamed(CompilerContext &context, SourceUnit &unit, const std::vector<unsigned int> &globalIDs)
+{
+    const auto &limits = context.getOptions().limits;
+    const identifierVect &identifiers = context.getIdentifiers();
+
+    std::ostream nullStrm(nullptr);
+    const TraceScope trace("bodies", unit.filePath);
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = unitDeadline(unit, limits, start);
+    auto parser = newStreamParser(context, unit, ParsePasses::ppBODIES, nullStrm, deadline);
+    TokenStream stream(unit.filePath, globalIDs, limits, deadline);
+
+    Generator generator(unit.name, identifiers);
+    generator.setOutDir(context.getOptions().outDir);
+    unit.outFilePath = generator.getOutFilePath();
+    // the output only replaces the old one once it's complete
+    const std::string partPath = unit.outFilePath + ".part";
+    const int fd = open(partPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        unit.diagnostics << "ERR: CAN'T WRITE " << unit.outFilePath << '\n';
+        return;
+    }
+
+    bool written = true;
+    const TokenFeed feed = [&](tokensVect &tokens, unsigned int &curTokenId, bool classStart)
+    {
+        // the functions parsed so far are generated by now
+        unit.stats.vmBytes += generator.getOutput().size();
+        written = generator.flushOutput(fd) && written;
+        stream.feed(tokens, curTokenId, classStart);
+    };
+
+    parser->setDirectEmission(&generator);
+    const bool streamed = parseStreamed(*parser, stream, feed, identifiers);
+    parser->setDirectEmission(NULL);
+    unit.parsed = streamed && parser->getFinishedCorrectly();
+    unit.stats.astNodes = parser->getNumAstNodes();
+
+    generator.finishOutput();
+    unit.stats.vmBytes += generator.getOutput().size();
+    written = generator.flushOutput(fd) && written;
+    written = close(fd) == 0 && written;
+    unit.busyTime += std::chrono::steady_clock::now() - start;
+
+    bool complete = false;
+    if (!streamed)
+        unit.diagnostics << "ERR: " << unit.filePath << " CHANGED WHILE IT WAS COMPILED\n";
+    else if (!stream.getLimitHit().empty())
+        unit.diagnostics << "ERR: LIMIT: " << unit.filePath << ": " << stream.getLimitHit() << '\n';
+    // the parser has reported its own limit
+    else if (!parser->getStoppedAtLimit())
+    {
+        complete = written && std::rename(partPath.c_str(), unit.outFilePath.c_str()) == 0;
+        if (!complete)
+            unit.diagnostics << "ERR: CAN'T WRITE " << unit.outFilePath << '\n';
+    }
+    if (complete)
+        return;
+
+    // no output at all, like for a unit over a limit in the other builds
+    unlink(partPath.c_str());
+    unit.parsed = false;
+}
+
+}
+
+bool streamCompile(const CompilerOptions &options, const std::vector<std::string> &filePaths,
+    ThreadPool &pool, std::ostream &out, std::ostream &err)
+{
+    CompilerContext context(options);
+    const ResourceLimits &limits = options.limits;
+
+    std::vector<SourceUnit> units(filePaths.size());
+    std::vector<std::vector<unsigned int>> classIDs(units.size());
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        units[i].filePath = filePaths[i];
+    }
+    {
+        const TraceScope stageTrace("stage", "lex");
+        pool.parallelFor(units.size(), [&](size_t unitIdx)
+        {
+            scanUnit(units[unitIdx], limits, classIDs[unitIdx]);
+        });
+    }
+
+    // the identifiers merged and the classes declared
+    // in file order, the same ids the other builds hand out
+    size_t numIdents = 0;
+    for (const auto &unit : units)
+    {
+        numIdents += unit.lexState.identifiers.size();
+    }
+    context.reserveIdentifiers(numIdents);
+
+    std::vector<std::vector<unsigned int>> globalIDs(units.size());
+    for (size_t unitIdx = 0; unitIdx < units.size(); ++unitIdx)
+    {
+        auto &unit = units[unitIdx];
+        if (!unit.lexed)
+            continue;
+        auto &unitIdents = unit.lexState.identifiers;
+        globalIDs[unitIdx].reserve(unitIdents.size());
+        for (const auto &ident : unitIdents)
+        {
+            globalIDs[unitIdx].push_back(context.addIdentifier(ident));
+        }
+        identifierVect().swap(unitIdents);
+
+        for (unsigned int classID : classIDs[unitIdx])
+        {
+            const unsigned int classNameID = globalIDs[unitIdx][classID];
+            context.getClassTable().findOrAdd(classNameID);
+            unit.classNameIDs.push_back(classNameID);
+        }
+    }
+
+    const identifierVect &identifiers = context.getIdentifiers();
+
+    // phase 1: what the files can refer to in each other
+    {
+        const TraceScope stageTrace("stage", "signatures");
+        pool.parallelFor(units.size(), [&](size_t unitIdx)
+        {
+            auto &unit = units[unitIdx];
+            if (!unit.lexed || unit.numTokens == 0)
+                return;
+
+            std::ostream nullStrm(nullptr);
+            const TraceScope trace("signatures", unit.filePath);
+            const auto start = std::chrono::steady_clock::now();
+            const auto deadline = unitDeadline(unit, limits, start);
+            auto parser = newStreamParser(context, unit, ParsePasses::ppSIGNATURES, nullStrm, deadline);
+            TokenStream stream(unit.filePath, globalIDs[unitIdx], limits, deadline);
+            const TokenFeed feed = [&stream](tokensVect &tokens, unsigned int &curTokenId, bool classStart)
+            {
+                stream.feed(tokens, curTokenId, classStart);
+            };
+            // a file that changed is reported by phase 2, a limit here
+            const bool streamed = parseStreamed(*parser, stream, feed, identifiers);
+            unit.busyTime += std::chrono::steady_clock::now() - start;
+            if (streamed && !stream.getLimitHit().empty())
+                unit.diagnostics << "ERR: LIMIT: " << unit.filePath << ": " << stream.getLimitHit() << '\n';
+            unit.overLimit = streamed && (!stream.getLimitHit().empty() || parser->getStoppedAtLimit());
+        });
+    }
+
+    // phase 2: function bodies and code, every file on its own
+    {
+        const TraceScope stageTrace("stage", "bodies");
+        pool.parallelFor(units.size(), [&](size_t unitIdx)
+        {
+            auto &unit = units[unitIdx];
+            if (!unit.lexed || unit.numTokens == 0 || unit.overLimit)
+                return;
+            generateStreamed(context, unit, globalIDs[unitIdx]);
+        });
+    }
+
+    bool success = true;
+    for (const auto &unit : units)
+    {
+        err << unit.diagnostics.str();
+        if (!unit.lexed || (!unit.parsed && unit.numTokens != 0))
+            success = false;
+    }
+
+    if (options.stats)
+    {
+        printStats(units, out);
+        // the process' high water mark, what the streaming is for
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        out << "peak memory: " << usage.ru_maxrss << " KB\n";
+    }
+    return success;
+}
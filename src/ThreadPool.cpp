@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+    for (unsigned int i = 1; i < numThreads; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCond.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCond.wait(lock, [this]{ return stopping || !pendingJobs.empty(); });
+            if (pendingJobs.empty())
+                return;
+
+            job = pendingJobs.front();
+            pendingJobs.pop_front();
+        }
+        runTasks(*job);
+    }
+}
+
+void ThreadPool::runTasks(Job &job)
+{
+    size_t numDone = 0;
+    while (true)
+    {
+        const size_t taskIdx = job.nextTask.fetch_add(1);
+        if (taskIdx >= job.numTasks)
+            break;
+
+        (*job.func)(taskIdx);
+        numDone++;
+    }
+    if (numDone == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(job.mutex);
+    job.finishedTasks += numDone;
+    if (job.finishedTasks == job.numTasks)
+        job.finishedCond.notify_all();
+}
+
+void ThreadPool::parallelFor(size_t numTasks, const std::function<void(size_t)> &func)
+{
+    if (workers.empty() || numTasks <= 1)
+    {
+        for (size_t i = 0; i < numTasks; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<Job>(&func, numTasks);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        // one entry per worker that can help,
+        // the caller takes tasks as well
+        const size_t numHelpers = std::min(workers.size(), numTasks - 1);
+        for (size_t i = 0; i < numHelpers; ++i)
+        {
+            pendingJobs.push_back(job);
+        }
+    }
+    queueCond.notify_all();
+
+    runTasks(*job);
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finishedCond.wait(lock, [&job]{ return job->finishedTasks == job->numTasks; });
+}
@@ -0,0 +1,125 @@
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "Trace.h"
+
+namespace
+{
+
+// room for the events of a few files before the buffer grows
+const size_t eventsReserved = 4096;
+
+struct TraceEvent
+{
+    // 'B'egin or 'E'nd
+    char phase;
+    const char *category;
+    std::string name;
+    std::chrono::steady_clock::time_point time;
+};
+
+struct ThreadTrace
+{
+    long tid = 0;
+    std::vector<TraceEvent> events;
+};
+
+std::chrono::steady_clock::time_point traceStart;
+std::mutex threadTracesMutex;
+// owned here, so that they outlive their threads (the pools')
+std::vector<std::unique_ptr<ThreadTrace>> threadTraces;
+thread_local ThreadTrace *threadTrace = NULL;
+
+ThreadTrace &getThreadTrace()
+{
+    if (threadTrace != NULL)
+        return *threadTrace;
+
+    auto trace = std::make_unique<ThreadTrace>();
+    trace->tid = syscall(SYS_gettid);
+    trace->events.reserve(eventsReserved);
+    threadTrace = trace.get();
+
+    std::lock_guard<std::mutex> lock(threadTracesMutex);
+    threadTraces.push_back(std::move(trace));
+    return *threadTrace;
+}
+
+void writeJsonString(std::ostream &out, const std::string &str)
+{
+    out << '"';
+    for (const char c : str)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+}
+
+void startTracing()
+{
+    traceStart = std::chrono::steady_clock::now();
+    tracingOn = true;
+}
+
+void traceBegin(const char *category, const std::string &name)
+{
+    getThreadTrace().events.push_back({'B', category, name, std::chrono::steady_clock::now()});
+}
+
+void traceEnd()
+{
+    getThreadTrace().events.push_back({'E', NULL, std::string(), std::chrono::steady_clock::now()});
+}
+
+bool writeTrace(const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+
+    const long pid = getpid();
+    std::lock_guard<std::mutex> lock(threadTracesMutex);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto &trace : threadTraces)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid <<
+            ",\"tid\":" << trace->tid << ",\"args\":{\"name\":\"" <<
+            (trace->tid == pid ? "main" : "worker") << "\"}}";
+        first = false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    for (const auto &trace : threadTraces)
+    {
+        for (const auto &event : trace->events)
+        {
+            // microseconds
+            const double ts = std::chrono::duration<double, std::micro>(event.time - traceStart).count();
+            out << ",\n{\"ph\":\"" << event.phase << "\",\"ts\":" << ts <<
+                ",\"pid\":" << pid << ",\"tid\":" << trace->tid;
+            if (event.phase == 'B')
+            {
+                out << ",\"cat\":\"" << event.category << "\",\"name\":";
+                writeJsonString(out, event.name);
+            }
+            out << '}';
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out.good();
+}